@@ -0,0 +1,477 @@
+#include "auto_tuner.h"
+#include "md5_mb.h"
+#include "uring.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <system_error>
+#include <vector>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/magic.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/statfs.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace std::chrono;
+
+static const uint64_t calibrationBytes = 64 * 1024 * 1024; // upper bound of calibration data
+static const double calibrationSeconds = 0.1;               // upper bound of every calibration
+static const size_t directAlignment = 4096;                 // offset, length and buffer alignment of direct reads
+
+const char *ioEngineName(IoEngine engine)
+{
+    switch (engine)
+    {
+    case IoEngine::Single:
+        return "single";
+    case IoEngine::Multi:
+        return "multi";
+    case IoEngine::Mmap:
+        return "mmap";
+    case IoEngine::Uring:
+        return "uring";
+    case IoEngine::Pread:
+        return "pread";
+    default:
+        return "unknown";
+    }
+}
+
+/**
+ * @brief      Parses engine name written by ioEngineName().
+ */
+static bool parseIoEngine(const string &name, IoEngine &engine)
+{
+    for (IoEngine candidate : {IoEngine::Single, IoEngine::Multi, IoEngine::Mmap, IoEngine::Uring, IoEngine::Pread})
+    {
+        if (name == ioEngineName(candidate))
+        {
+            engine = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief      Counts CPUs the process may run on.
+ */
+static size_t availableCpus()
+{
+    cpu_set_t set;
+
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        return max(CPU_COUNT(&set), 1);
+    }
+
+    return max(sysconf(_SC_NPROCESSORS_ONLN), 1L);
+}
+
+/**
+ * @brief      Reads the first line of a sysfs attribute, empty if it is missing.
+ */
+static string readAttribute(const string &path)
+{
+    ifstream file(path);
+    string value;
+    getline(file, value);
+    return value;
+}
+
+/**
+ * @brief      Checks that most of the first length bytes of file are in page cache.
+ *
+ * @return     True also when residency cannot be found out.
+ */
+static bool isResident(int fd, uint64_t length)
+{
+    if (length == 0)
+    {
+        return false;
+    }
+
+    void *mapping = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+
+    if (mapping == MAP_FAILED)
+    {
+        return true;
+    }
+
+    long pageSize = sysconf(_SC_PAGESIZE);
+    vector<unsigned char> pages((length + pageSize - 1) / pageSize);
+    bool known = mincore(mapping, length, pages.data()) == 0;
+    munmap(mapping, length);
+
+    size_t resident = count_if(pages.begin(), pages.end(), [](unsigned char page) { return page & 1; });
+    return !known || resident * 2 >= pages.size();
+}
+
+AutoTuner::AutoTuner(size_t blockSize, HashAlgorithm algorithm, const string &cacheFile) :
+    _blockSize(max(blockSize, static_cast<size_t>(1))),
+    _algorithm(algorithm),
+    _cacheFile(cacheFile),
+    _cpus(availableCpus())
+{
+}
+
+string AutoTuner::defaultCacheFile()
+{
+    const char *cache = getenv("XDG_CACHE_HOME");
+
+    if (cache != nullptr && cache[0] != '\0')
+    {
+        return string(cache) + "/blockHasher/tuning";
+    }
+
+    const char *home = getenv("HOME");
+    return home != nullptr && home[0] != '\0' ? string(home) + "/.cache/blockHasher/tuning" : "";
+}
+
+AutoTuner::Device AutoTuner::probeDevice(const FileHandle &input)
+{
+    Device device;
+    struct stat st;
+    struct statfs fs;
+
+    if (fstat(input.get(), &st) != 0)
+    {
+        return device;
+    }
+
+    dev_t dev = S_ISBLK(st.st_mode) ? st.st_rdev : st.st_dev;
+    device.id = to_string(major(dev)) + ":" + to_string(minor(dev));
+
+    if (S_ISBLK(st.st_mode))
+    {
+        device.fsType = "blockdev";
+    }
+    else if (fstatfs(input.get(), &fs) == 0)
+    {
+        switch (static_cast<unsigned long>(fs.f_type))
+        {
+        case TMPFS_MAGIC:
+            device.fsType = "tmpfs";
+            device.memory = true;
+            break;
+        case RAMFS_MAGIC:
+            device.fsType = "ramfs";
+            device.memory = true;
+            break;
+        case NFS_SUPER_MAGIC:
+            device.fsType = "nfs";
+            device.network = true;
+            break;
+        case CIFS_SUPER_MAGIC:
+        case SMB2_SUPER_MAGIC:
+            device.fsType = "smb";
+            device.network = true;
+            break;
+        case FUSE_SUPER_MAGIC:
+            device.fsType = "fuse";
+            device.network = true; // userspace filesystems are mostly remote and prefer sequential reads
+            break;
+        case EXT4_SUPER_MAGIC:
+            device.fsType = "ext4";
+            break;
+        case XFS_SUPER_MAGIC:
+            device.fsType = "xfs";
+            break;
+        case BTRFS_SUPER_MAGIC:
+            device.fsType = "btrfs";
+            break;
+        case OVERLAYFS_SUPER_MAGIC:
+            device.fsType = "overlay";
+            break;
+        default:
+            char magic[32];
+            snprintf(magic, sizeof(magic), "0x%lx", static_cast<unsigned long>(fs.f_type));
+            device.fsType = magic;
+        }
+    }
+
+    // partition attributes are found in queue directory of its parent disk
+    string sysfs = "/sys/dev/block/" + device.id;
+    string rotational = readAttribute(sysfs + "/queue/rotational");
+
+    if (rotational.empty())
+    {
+        rotational = readAttribute(sysfs + "/../queue/rotational");
+    }
+
+    device.rotational = rotational == "1";
+
+    char target[PATH_MAX];
+    ssize_t length = readlink(sysfs.c_str(), target, sizeof(target) - 1);
+
+    if (length > 0)
+    {
+        target[length] = '\0';
+        device.nvme = string(target).find("/nvme") != string::npos;
+    }
+
+    return device;
+}
+
+double AutoTuner::calibrateHash() const
+{
+    // hashing speed hardly depends on block size above a few pages, so calibration buffer stays small
+    size_t lanes = md5MultiLanes();
+    size_t blockSize = min(_blockSize, static_cast<size_t>(1024 * 1024));
+    vector<uint8_t> data(blockSize * lanes);
+    vector<const uint8_t *> pointers(lanes);
+    vector<size_t> lengths(lanes, blockSize);
+    vector<Digest> digests(lanes);
+    HashBatchFunc hashBatch = hashBatchFunc(_algorithm);
+
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        data[i] = static_cast<uint8_t>(i * 2654435761u >> 13); // not zero, zero blocks are skipped by hashers
+    }
+
+    for (size_t lane = 0; lane < lanes; ++lane)
+    {
+        pointers[lane] = data.data() + lane * blockSize;
+    }
+
+    uint64_t hashed = 0;
+    auto start = steady_clock::now();
+    double seconds = 0;
+
+    while (hashed < calibrationBytes && seconds < calibrationSeconds)
+    {
+        hashBatch(pointers.data(), lengths.data(), lanes, digests.data());
+        hashed += data.size();
+        seconds = duration<double>(steady_clock::now() - start).count();
+    }
+
+    return seconds > 0 ? hashed / seconds : 0;
+}
+
+double AutoTuner::calibrateRead(const string &inputFile, const FileHandle &input, uint64_t fileSize,
+                                bool &pageCache) const
+{
+    size_t chunk = (max(_blockSize, static_cast<size_t>(1024 * 1024)) + directAlignment - 1) / directAlignment *
+                   directAlignment;
+    uint64_t limit = min(fileSize, calibrationBytes) / directAlignment * directAlignment;
+    unique_ptr<uint8_t, decltype(&free)> data(static_cast<uint8_t *>(aligned_alloc(directAlignment, chunk)), &free);
+
+    if (!data)
+    {
+        throw bad_alloc();
+    }
+
+    // direct reads bypass page cache, so input read before does not pass for a fast device
+    int fd = limit > 0 ? open(inputFile.c_str(), O_RDONLY | O_DIRECT | O_CLOEXEC) : -1;
+    uint64_t done = 0;
+    auto start = steady_clock::now();
+    double seconds = 0;
+
+    while (fd >= 0 && done < limit && seconds < calibrationSeconds)
+    {
+        ssize_t count = pread(fd, data.get(), static_cast<size_t>(min<uint64_t>(chunk, limit - done)), done);
+
+        if (count <= 0)
+        {
+            if (count < 0 && errno == EINTR)
+            {
+                continue;
+            }
+
+            // filesystem does not take direct reads after all, reading through page cache
+            close(fd);
+            fd = -1;
+            break;
+        }
+
+        done += count;
+        seconds = duration<double>(steady_clock::now() - start).count();
+    }
+
+    if (fd >= 0)
+    {
+        close(fd);
+        pageCache = false;
+        return seconds > 0 ? done / seconds : 0;
+    }
+
+    // rate of data already in page cache is the memory one, it must not be cached for the device
+    limit = min(fileSize, calibrationBytes);
+    pageCache = isResident(input.get(), limit);
+    done = 0;
+    start = steady_clock::now();
+    seconds = 0;
+
+    while (done < limit && seconds < calibrationSeconds)
+    {
+        size_t length = static_cast<size_t>(min<uint64_t>(chunk, limit - done));
+        input.readAt(data.get(), length, done);
+        done += length;
+        seconds = duration<double>(steady_clock::now() - start).count();
+    }
+
+    return seconds > 0 ? done / seconds : 0;
+}
+
+Tuning AutoTuner::choose(const Device &device, double hashRate, double readRate) const
+{
+    Tuning tuning;
+    tuning.hashRate = hashRate;
+    tuning.readRate = readRate;
+
+    // enough threads to hash as fast as the device reads
+    double ratio = hashRate > 0 ? readRate / hashRate : 1;
+    tuning.threads = min(_cpus, max(static_cast<size_t>(1), static_cast<size_t>(ceil(ratio))));
+
+    if (device.memory || ratio >= _cpus)
+    {
+        // data is in memory, hashing directly from page cache saves the copy
+        tuning.engine = IoEngine::Mmap;
+        tuning.threads = _cpus;
+    }
+    else if (device.network || device.rotational)
+    {
+        // single sequential reader keeps read-ahead effective and the disk head in place
+        tuning.engine = IoEngine::Multi;
+    }
+    else
+    {
+        tuning.engine = IoEngine::Uring;
+        tuning.queueDepth = device.nvme ? 64 : 32;
+
+        try
+        {
+            IoUring probe(1);
+        }
+        catch (const system_error &)
+        {
+            tuning.engine = IoEngine::Pread; // parallel positional reads keep the SSD queue busy as well
+        }
+    }
+
+    return tuning;
+}
+
+string AutoTuner::cacheKey(const Device &device) const
+{
+    char host[HOST_NAME_MAX + 1] = {};
+    gethostname(host, sizeof(host) - 1);
+
+    return string(host[0] != '\0' ? host : "localhost") + " " + device.id + " " + device.fsType + " " +
+           to_string(_cpus) + " " + hashAlgorithmName(_algorithm) + " " + to_string(_blockSize);
+}
+
+bool AutoTuner::loadCached(const string &key, Tuning &tuning) const
+{
+    ifstream file(_cacheFile);
+    string line;
+
+    // line: <host> <device> <filesystem> <cpus> <algorithm> <block size> <engine> <threads> <depth> <rates>
+    while (getline(file, line))
+    {
+        if (line.compare(0, key.size() + 1, key + " ") != 0)
+        {
+            continue;
+        }
+
+        istringstream values(line.substr(key.size() + 1));
+        string engine;
+
+        if (values >> engine >> tuning.threads >> tuning.queueDepth >> tuning.hashRate >> tuning.readRate &&
+                parseIoEngine(engine, tuning.engine))
+        {
+            tuning.cached = true;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void AutoTuner::storeCached(const string &key, const Tuning &tuning) const
+{
+    vector<string> lines;
+    string line;
+
+    {
+        ifstream file(_cacheFile);
+
+        while (getline(file, line))
+        {
+            if (!line.empty() && line.compare(0, key.size() + 1, key + " ") != 0)
+            {
+                lines.push_back(line);
+            }
+        }
+    }
+
+    ostringstream entry;
+    entry << key << " " << ioEngineName(tuning.engine) << " " << tuning.threads << " " << tuning.queueDepth <<
+          " " << static_cast<uint64_t>(tuning.hashRate) << " " << static_cast<uint64_t>(tuning.readRate);
+    lines.push_back(entry.str());
+
+    // cache is only an optimization, failing to write it is not an error
+    for (size_t slash = _cacheFile.find('/', 1); slash != string::npos; slash = _cacheFile.find('/', slash + 1))
+    {
+        mkdir(_cacheFile.substr(0, slash).c_str(), 0755);
+    }
+
+    string temporary = _cacheFile + "." + to_string(getpid());
+    ofstream file(temporary, ios::out | ios::trunc);
+
+    for (const auto &cached : lines)
+    {
+        file << cached << "\n";
+    }
+
+    file.close();
+
+    if (!file || rename(temporary.c_str(), _cacheFile.c_str()) != 0) // readers never see partial cache
+    {
+        unlink(temporary.c_str());
+    }
+}
+
+Tuning AutoTuner::tune(const string &inputFile, bool recalibrate)
+{
+    FileHandle input(inputFile);
+    uint64_t fileSize = input.size();
+    size_t lanes = md5MultiLanes();
+    uint64_t batches = (fileSize / _blockSize + 1 + lanes - 1) / lanes;
+    Tuning tuning;
+
+    if (batches < 4) // nothing to overlap, calibration would take longer than hashing
+    {
+        return tuning;
+    }
+
+    Device device = probeDevice(input);
+    string key = cacheKey(device);
+
+    if (recalibrate || _cacheFile.empty() || !loadCached(key, tuning))
+    {
+        bool pageCache = false;
+        tuning = choose(device, calibrateHash(), calibrateRead(inputFile, input, fileSize, pageCache));
+
+        if (!_cacheFile.empty() && !pageCache)
+        {
+            storeCached(key, tuning);
+        }
+    }
+
+    // more threads than batches only waste buffers
+    tuning.threads = static_cast<size_t>(min<uint64_t>(tuning.threads, batches));
+    return tuning;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "file_handle.h"
+#include "hash_algorithm.h"
+
+/**
+ * @brief      Input engines of the command line.
+ */
+enum class IoEngine
+{
+    Single, // single-thread pipeline
+    Multi,  // sequential reader and hashing threads
+    Mmap,   // --mmap
+    Uring,  // --uring
+    Pread   // --pread
+};
+
+/**
+ * @brief      Gets engine name used in cache and messages.
+ */
+const char *ioEngineName(IoEngine engine);
+
+/**
+ * @brief      Parameters chosen by AutoTuner.
+ */
+struct Tuning
+{
+    IoEngine engine = IoEngine::Single;
+    size_t threads = 0;       // hashing threads, 0 for single-thread pipeline
+    size_t queueDepth = 32;   // reads in flight of io_uring
+    double hashRate = 0;      // bytes per second hashed by one thread
+    double readRate = 0;      // bytes per second read from the device
+    bool cached = false;      // taken from cache without calibration
+};
+
+/**
+ * @brief      Chooses engine and thread count from CPU count, file size, filesystem and calibration.
+ *
+ * Hash speed of one thread and read speed of the input device are calibrated
+ * once and cached per host, device, filesystem, CPU count, algorithm and block
+ * size, so later runs skip calibration. Block size is never changed, so the
+ * signature stays the same as without tuning.
+ */
+class AutoTuner
+{
+public:
+    /**
+     * @brief      Constructs the tuner.
+     *
+     * @param[in]  blockSize  The block size in bytes.
+     * @param[in]  algorithm  The hash algorithm.
+     * @param[in]  cacheFile  The cache file, empty to calibrate every time.
+     */
+    AutoTuner(size_t blockSize, HashAlgorithm algorithm, const std::string &cacheFile = defaultCacheFile());
+
+    /**
+     * @brief      Chooses parameters for hashing regular file or block device.
+     *
+     * @param[in]  inputFile    The input file.
+     * @param[in]  recalibrate  Ignore cached parameters.
+     *
+     * @return     The parameters.
+     */
+    Tuning tune(const std::string &inputFile, bool recalibrate = false);
+
+    /**
+     * @brief      Gets cache location: $XDG_CACHE_HOME/blockHasher/tuning or ~/.cache/blockHasher/tuning.
+     *
+     * @return     The file name, empty if home directory is unknown.
+     */
+    static std::string defaultCacheFile();
+private:
+    /**
+     * @brief      Storage the input lives on.
+     */
+    struct Device
+    {
+        std::string id;          // major:minor
+        std::string fsType;      // filesystem name or magic
+        bool memory = false;     // tmpfs or ramfs, reads are memory copies
+        bool network = false;    // network or FUSE filesystem
+        bool rotational = false; // spinning disk
+        bool nvme = false;       // NVMe device takes deep queues
+    };
+
+    size_t _blockSize;
+    HashAlgorithm _algorithm;
+    std::string _cacheFile;
+    size_t _cpus;
+
+    static Device probeDevice(const FileHandle &input);
+    double calibrateHash() const;
+    double calibrateRead(const std::string &inputFile, const FileHandle &input, uint64_t fileSize,
+                         bool &pageCache) const; // pageCache set when the rate is the one of page cache
+    Tuning choose(const Device &device, double hashRate, double readRate) const;
+    std::string cacheKey(const Device &device) const;
+    bool loadCached(const std::string &key, Tuning &tuning) const;
+    void storeCached(const std::string &key, const Tuning &tuning) const;
+};
@@ -0,0 +1,194 @@
+#include "batch_hasher.h"
+#include "file_handle.h"
+#include "md5_mb.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <dirent.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+/**
+ * @brief      Block of one of the batch files.
+ */
+struct BatchBlock
+{
+    shared_ptr<FileHandle> file; // shared by all blocks of the file, closed after the last one
+    uint64_t offset;
+    size_t length;
+    bool hole;
+};
+
+/**
+ * @brief      Adds regular files of directory tree sorted by name, symbolic links are not followed.
+ */
+static void walkDirectory(const string &directory, vector<string> &files)
+{
+    DIR *dir = opendir(directory.c_str());
+
+    if (dir == nullptr)
+    {
+        throw invalid_argument("cannot open directory " + directory + ": " + strerror(errno));
+    }
+
+    vector<string> names;
+
+    while (dirent *entry = readdir(dir))
+    {
+        string name = entry->d_name;
+
+        if (name != "." && name != "..")
+        {
+            names.push_back(move(name));
+        }
+    }
+
+    closedir(dir);
+    sort(names.begin(), names.end());
+
+    for (const auto &name : names)
+    {
+        string path = directory + (directory.back() == '/' ? "" : "/") + name;
+        struct stat st;
+
+        if (lstat(path.c_str(), &st) != 0)
+        {
+            continue; // removed while walking
+        }
+
+        if (S_ISDIR(st.st_mode))
+        {
+            walkDirectory(path, files);
+        }
+        else if (S_ISREG(st.st_mode))
+        {
+            files.push_back(move(path));
+        }
+    }
+}
+
+BatchHasher::BatchHasher(size_t blockSize, size_t threads, bool hugePages) :
+    MultiThreadHasher(blockSize, threads, hugePages)
+{
+}
+
+void BatchHasher::Hash(const string &input, const string &outputFile)
+{
+    _fileCount = 0;
+    MultiThreadHasher::Hash(input, outputFile);
+    _manifest.reset();
+}
+
+shared_ptr<SignatureWriter> BatchHasher::openOutput(const string &, const string &outputFile)
+{
+    _manifest = make_shared<ManifestWriter>(outputFile, _algorithm, _size, _flushInterval);
+    return _manifest;
+}
+
+vector<string> BatchHasher::listFiles(const string &input)
+{
+    vector<string> files;
+    struct stat st;
+
+    if (stat(input.c_str(), &st) != 0)
+    {
+        throw invalid_argument("cannot open " + input);
+    }
+
+    if (S_ISDIR(st.st_mode))
+    {
+        walkDirectory(input, files);
+        return files;
+    }
+
+    ifstream list(input);
+    string line;
+
+    while (getline(list, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+
+        if (!line.empty())
+        {
+            files.push_back(line);
+        }
+    }
+
+    return files;
+}
+
+void BatchHasher::readBlocks(const string &input)
+{
+    size_t lanes = md5MultiLanes();
+    vector<BatchBlock> batch; // blocks of one task, may belong to several files
+
+    auto submit = [this](vector<BatchBlock> blocks)
+    {
+        addHasherTask([this, blocks = move(blocks)]()
+        {
+            vector<shared_ptr<Buffer>> buffers;
+
+            for (const auto &block : blocks)
+            {
+                if (block.hole)
+                {
+                    buffers.push_back(holeBlock(block.length));
+                    continue;
+                }
+
+                auto buffer = acquireBuffer();
+                buffer->setSize(block.length);
+                {
+                    StageTimer timer(_stats.get(), Stage::Read);
+                    block.file->readAt(buffer->get(), block.length, block.offset);
+                }
+
+                buffers.push_back(move(buffer));
+            }
+
+            return hashBlocks(buffers);
+        });
+    };
+
+    for (const auto &path : listFiles(input))
+    {
+        if (_exceptOccurred)
+        {
+            return;
+        }
+
+        auto file = make_shared<FileHandle>(path);
+        size_t fileSize = file->size();
+        SparseMap holes(file->get(), fileSize);
+        size_t blockCount = _size > 0 ? fileSize / _size + 1 : 1; // last block may be empty
+
+        _manifest->addFile(path, blockCount); // before its digests can reach the writer
+        _inputSize += fileSize;
+        ++_fileCount;
+
+        for (size_t i = 0; i < blockCount && !_exceptOccurred; ++i)
+        {
+            size_t offset = i * _size;
+            size_t length = min(_size, fileSize - min(offset, fileSize));
+            batch.push_back({file, offset, length, holes.isHole(offset, length)});
+
+            if (batch.size() == lanes)
+            {
+                submit(move(batch));
+                batch = vector<BatchBlock>();
+            }
+        }
+    }
+
+    if (!batch.empty())
+    {
+        submit(move(batch));
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "block_hasher.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief      Hasher of many files writing one manifest.
+ *
+ * Blocks of all files go through the same thread pool and completion ring as
+ * blocks of a single file. Batches are filled with blocks regardless of file
+ * boundaries, so small files share lanes of MD5 kernel and tasks instead of
+ * getting one task each. Hasher threads read their blocks with positional reads.
+ */
+class BatchHasher : public MultiThreadHasher
+{
+public:
+    /**
+     * @brief      Constructs the batch hasher.
+     *
+     * @param[in]  blockSize  The block size in bytes.
+     * @param[in]  threads    The number of hasher threads.
+     * @param[in]  hugePages  Back block buffers with huge pages.
+     */
+    BatchHasher(size_t blockSize = 1024 * 1024, size_t threads = 4, bool hugePages = false);
+
+    /**
+     * @brief      Hashes files to manifest.
+     *
+     * @param[in]  input       Directory hashed recursively, or text file listing one path per line.
+     * @param[in]  outputFile  The manifest, overwritten.
+     */
+    virtual void Hash(const std::string &input, const std::string &outputFile) override;
+
+    /**
+     * @brief      Gets the number of files hashed by the last Hash().
+     */
+    size_t fileCount() const
+    {
+        return _fileCount;
+    }
+protected:
+    virtual std::shared_ptr<SignatureWriter> openOutput(const std::string &input, const std::string &outputFile) override;
+    virtual void readBlocks(const std::string &input) override;
+
+    // every worker reads its own blocks
+    virtual bool workersReadBlocks() const override
+    {
+        return true;
+    }
+
+    // blocks of many files
+    virtual bool supportsFileDigest() const override
+    {
+        return false;
+    }
+private:
+    std::shared_ptr<ManifestWriter> _manifest;
+    size_t _fileCount = 0;
+
+    /**
+     * @brief      Lists files to hash in stable order.
+     *
+     * @param[in]  input  Directory or file list.
+     *
+     * @return     The paths.
+     */
+    static std::vector<std::string> listFiles(const std::string &input);
+};
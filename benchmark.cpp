@@ -0,0 +1,520 @@
+#include "block_hasher.h"
+#include "hash_algorithm.h"
+#include "md5.h"
+#include "md5_mb.h"
+#include "mmap_hasher.h"
+#include "pread_hasher.h"
+#include "uring_hasher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace std::chrono;
+
+/**
+ * @brief      Benchmark settings.
+ */
+struct BenchmarkOptions
+{
+    uint64_t dataSize = 256 * 1024 * 1024;  // bytes of synthetic input
+    size_t repeats = 3;                     // measured runs of every case after a warm-up run
+    vector<size_t> blockSizes{4096, 64 * 1024, 1024 * 1024, 4 * 1024 * 1024};
+    vector<size_t> threads;                 // powers of two up to CPU count by default
+    vector<string> suites{"kernel", "pipeline", "scaling"};
+    string directory = ".";                 // location of on-disk input
+    string output;                          // results file, standard output if empty
+};
+
+/**
+ * @brief      Timing of repeated runs.
+ */
+struct Timing
+{
+    double best = 0;    // seconds
+    double median = 0;  // seconds
+};
+
+/**
+ * @brief      Synthetic input in memory (memfd) or on disk, removed at destruction.
+ */
+class BenchmarkInput
+{
+public:
+    /**
+     * @brief      Creates input of random data.
+     *
+     * @param[in]  size       The size in bytes.
+     * @param[in]  directory  Directory of the input file, empty for memory backed one.
+     */
+    BenchmarkInput(uint64_t size, const string &directory)
+    {
+        if (directory.empty())
+        {
+            _fd = memfd_create("blockHasherBenchmark", MFD_CLOEXEC);
+            _path = "/proc/self/fd/" + to_string(_fd);
+        }
+        else
+        {
+            _path = directory + "/blockHasherBenchmark." + to_string(getpid());
+            _fd = open(_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            _remove = true;
+        }
+
+        if (_fd < 0)
+        {
+            throw runtime_error("cannot create benchmark input " + _path);
+        }
+
+        vector<uint8_t> chunk(4 * 1024 * 1024);
+        uint64_t state = 0x9e3779b97f4a7c15;
+
+        for (uint64_t done = 0; done < size;)
+        {
+            size_t length = static_cast<size_t>(min<uint64_t>(chunk.size(), size - done));
+            fillRandom(chunk.data(), length, state);
+
+            if (pwrite(_fd, chunk.data(), length, done) != static_cast<ssize_t>(length))
+            {
+                close(_fd);
+                throw runtime_error("cannot write benchmark input " + _path);
+            }
+
+            done += length;
+        }
+
+        fsync(_fd); // measured runs read from page cache, not from dirty pages under writeback
+    }
+
+    ~BenchmarkInput()
+    {
+        close(_fd);
+
+        if (_remove)
+        {
+            unlink(_path.c_str());
+        }
+    }
+
+    BenchmarkInput(const BenchmarkInput &) = delete;
+    BenchmarkInput &operator=(const BenchmarkInput &) = delete;
+
+    const string &path() const
+    {
+        return _path;
+    }
+
+    /**
+     * @brief      Fills data with splitmix64 sequence, hashing inputs must not look like holes.
+     */
+    static void fillRandom(uint8_t *data, size_t length, uint64_t &state)
+    {
+        for (size_t i = 0; i < length; i += 8)
+        {
+            uint64_t z = (state += 0x9e3779b97f4a7c15);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+            z ^= z >> 31;
+            memcpy(data + i, &z, min<size_t>(8, length - i));
+        }
+    }
+private:
+    int _fd = -1;
+    string _path;
+    bool _remove = false;
+};
+
+/**
+ * @brief      Writer of results, one JSON object per line.
+ */
+class ResultWriter
+{
+public:
+    ResultWriter(const string &fileName)
+    {
+        if (!fileName.empty())
+        {
+            _file.open(fileName, ios::out | ios::trunc);
+
+            if (!_file)
+            {
+                throw runtime_error("cannot open results file " + fileName);
+            }
+        }
+    }
+
+    /**
+     * @brief      Starts a new record.
+     */
+    ResultWriter &begin(const string &suite)
+    {
+        _line.str("");
+        _line << "{\"suite\":\"" << suite << "\"";
+        return *this;
+    }
+
+    ResultWriter &field(const string &name, const string &value)
+    {
+        _line << ",\"" << name << "\":\"" << value << "\"";
+        return *this;
+    }
+
+    ResultWriter &field(const string &name, uint64_t value)
+    {
+        _line << ",\"" << name << "\":" << value;
+        return *this;
+    }
+
+    ResultWriter &field(const string &name, double value)
+    {
+        _line << ",\"" << name << "\":" << value;
+        return *this;
+    }
+
+    /**
+     * @brief      Adds throughput fields of the timing and writes the record.
+     *
+     * @param[in]  bytes   The bytes processed by one run.
+     * @param[in]  timing  The timing.
+     */
+    void end(uint64_t bytes, const Timing &timing)
+    {
+        field("bytes", bytes);
+        field("seconds", timing.median);
+        field("best_seconds", timing.best);
+        field("mb_per_s", timing.median > 0 ? bytes / timing.median / 1e6 : 0.0);
+        end();
+    }
+
+    void end()
+    {
+        _line << "}\n";
+        ostream &out = _file.is_open() ? static_cast<ostream &>(_file) : cout;
+        out << _line.str() << flush;
+    }
+private:
+    ofstream _file;
+    ostringstream _line;
+};
+
+/**
+ * @brief      Runs function once to warm up and then measures given number of runs.
+ */
+static Timing measure(size_t repeats, const function<void()> &run)
+{
+    vector<double> seconds;
+
+    run();
+
+    for (size_t i = 0; i < max<size_t>(repeats, 1); ++i)
+    {
+        auto start = steady_clock::now();
+        run();
+        seconds.push_back(duration<double>(steady_clock::now() - start).count());
+    }
+
+    sort(seconds.begin(), seconds.end());
+    return Timing{seconds.front(), seconds[seconds.size() / 2]};
+}
+
+/**
+ * @brief      Measures hash functions over blocks of in-memory buffer.
+ *
+ * md5bin() hashes one block at a time, batch functions of all algorithms hash
+ * as many blocks at once as the pipeline does.
+ */
+static void benchmarkKernels(const BenchmarkOptions &options, ResultWriter &results)
+{
+    size_t size = static_cast<size_t>(min<uint64_t>(options.dataSize, 64 * 1024 * 1024));
+    vector<uint8_t> data(size);
+    uint64_t state = 1;
+    BenchmarkInput::fillRandom(data.data(), data.size(), state);
+
+    for (size_t blockSize : options.blockSizes)
+    {
+        size_t blocks = max<size_t>(size / blockSize, 1);
+        size_t length = min(blockSize, size);
+        unsigned char md5Digest[16];
+
+        Timing timing = measure(options.repeats, [&]()
+        {
+            for (size_t i = 0; i < blocks; ++i)
+            {
+                md5bin(data.data() + i * blockSize % size, length, md5Digest);
+            }
+        });
+
+        results.begin("kernel").field("function", "md5bin").field("algorithm", "md5")
+        .field("block_size", static_cast<uint64_t>(blockSize)).end(static_cast<uint64_t>(blocks) * length, timing);
+
+        for (HashAlgorithm algorithm : {HashAlgorithm::Md5, HashAlgorithm::Crc32c, HashAlgorithm::Xxh128,
+                                        HashAlgorithm::Blake3, HashAlgorithm::Sha256})
+        {
+            HashBatchFunc hashBatch = hashBatchFunc(algorithm);
+            size_t lanes = md5MultiLanes();
+            vector<const uint8_t *> pointers(lanes);
+            vector<size_t> lengths(lanes, length);
+            vector<Digest> digests(lanes);
+
+            timing = measure(options.repeats, [&]()
+            {
+                for (size_t i = 0; i < blocks; i += lanes)
+                {
+                    size_t count = min(lanes, blocks - i);
+
+                    for (size_t lane = 0; lane < count; ++lane)
+                    {
+                        pointers[lane] = data.data() + (i + lane) * blockSize % size;
+                    }
+
+                    hashBatch(pointers.data(), lengths.data(), count, digests.data());
+                }
+            });
+
+            results.begin("kernel").field("function", "batch").field("algorithm", hashAlgorithmName(algorithm))
+            .field("kernel", algorithm == HashAlgorithm::Md5 ? md5MultiKernel() : "")
+            .field("block_size", static_cast<uint64_t>(blockSize)).end(static_cast<uint64_t>(blocks) * length, timing);
+        }
+    }
+}
+
+/**
+ * @brief      Creates hasher of named engine like the command line does.
+ */
+static unique_ptr<BlockHasher> createHasher(const string &engine, size_t blockSize, size_t threads)
+{
+    if (engine == "single")
+    {
+        return make_unique<SingleThreadHasher>(blockSize);
+    }
+
+    if (engine == "mmap")
+    {
+        return make_unique<MmapHasher>(blockSize, threads);
+    }
+
+    if (engine == "uring")
+    {
+        return make_unique<UringHasher>(blockSize, threads);
+    }
+
+    if (engine == "pread")
+    {
+        return make_unique<PreadHasher>(blockSize, threads);
+    }
+
+    return make_unique<MultiThreadHasher>(blockSize, threads);
+}
+
+/**
+ * @brief      Measures whole hashing of input file by one engine, signature goes to /dev/null.
+ */
+static void benchmarkHasher(const BenchmarkOptions &options, ResultWriter &results, const string &suite,
+                            const BenchmarkInput &input, const string &source, const string &engine,
+                            size_t blockSize, size_t threads)
+{
+    auto hasher = createHasher(engine, blockSize, threads);
+
+    Timing timing = measure(options.repeats, [&]()
+    {
+        hasher->Hash(input.path(), "/dev/null");
+    });
+
+    results.begin(suite).field("engine", engine).field("source", source)
+    .field("block_size", static_cast<uint64_t>(blockSize))
+    .field("threads", static_cast<uint64_t>(engine == "single" ? 1 : threads)).end(options.dataSize, timing);
+}
+
+/**
+ * @brief      Measures single-thread against multi-thread pipeline and scaling of all engines.
+ */
+static void benchmarkPipelines(const BenchmarkOptions &options, ResultWriter &results, bool pipeline,
+                               bool scaling)
+{
+    size_t defaultThreads = 4; // default of -m
+
+    for (const char *source : {"memory", "disk"})
+    {
+        BenchmarkInput input(options.dataSize, source == string("memory") ? "" : options.directory);
+
+        for (size_t blockSize : options.blockSizes)
+        {
+            if (pipeline)
+            {
+                benchmarkHasher(options, results, "pipeline", input, source, "single", blockSize, 1);
+                benchmarkHasher(options, results, "pipeline", input, source, "multi", blockSize, defaultThreads);
+            }
+
+            if (scaling)
+            {
+                for (const char *engine : {"multi", "mmap", "uring", "pread"})
+                {
+                    for (size_t threads : options.threads)
+                    {
+                        benchmarkHasher(options, results, "scaling", input, source, engine, blockSize, threads);
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief      Parses comma separated list of sizes.
+ */
+static vector<size_t> parseList(const string &value)
+{
+    vector<size_t> list;
+    stringstream stream(value);
+    string item;
+
+    while (getline(stream, item, ','))
+    {
+        size_t number = stoull(item);
+
+        if (number == 0)
+        {
+            throw invalid_argument("zero in list " + value);
+        }
+
+        list.push_back(number);
+    }
+
+    return list;
+}
+
+static void printUsage()
+{
+    cout << "Usage: blockHasherBenchmark" << endl;
+    cout << "       [--suite <kernel,pipeline,scaling>, default is all]" << endl;
+    cout << "       [--size <bytes of synthetic input, default is 256 MB>]" << endl;
+    cout << "       [--repeat <measured runs of every case, default is 3>]" << endl;
+    cout << "       [--block-sizes <comma separated bytes, default is 4096,65536,1048576,4194304>]" << endl;
+    cout << "       [--threads <comma separated counts, default is powers of two up to CPU count>]" << endl;
+    cout << "       [--dir <directory of on-disk input, default is current one>]" << endl;
+    cout << "       [--output <results file, default is standard output>]" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    BenchmarkOptions options;
+
+    for (size_t cpus = max(thread::hardware_concurrency(), 1u), threads = 1; threads <= cpus; threads *= 2)
+    {
+        options.threads.push_back(threads);
+    }
+
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            string option = argv[i];
+
+            if (i + 1 >= argc)
+            {
+                throw invalid_argument("missing value of " + option);
+            }
+
+            string value = argv[++i];
+
+            if (option == "--suite")
+            {
+                options.suites.clear();
+                stringstream stream(value);
+                string suite;
+
+                while (getline(stream, suite, ','))
+                {
+                    if (suite != "kernel" && suite != "pipeline" && suite != "scaling")
+                    {
+                        throw invalid_argument("unknown suite " + suite);
+                    }
+
+                    options.suites.push_back(suite);
+                }
+            }
+            else if (option == "--size")
+            {
+                options.dataSize = stoull(value);
+            }
+            else if (option == "--repeat")
+            {
+                options.repeats = stoull(value);
+            }
+            else if (option == "--block-sizes")
+            {
+                options.blockSizes = parseList(value);
+            }
+            else if (option == "--threads")
+            {
+                options.threads = parseList(value);
+            }
+            else if (option == "--dir")
+            {
+                options.directory = value;
+            }
+            else if (option == "--output")
+            {
+                options.output = value;
+            }
+            else
+            {
+                throw invalid_argument("unknown option " + option);
+            }
+        }
+
+        if (options.dataSize == 0)
+        {
+            throw invalid_argument("zero input size");
+        }
+    }
+    catch (...)
+    {
+        printUsage();
+        return -1;
+    }
+
+    auto enabled = [&](const string &suite)
+    {
+        return find(options.suites.begin(), options.suites.end(), suite) != options.suites.end();
+    };
+
+    try
+    {
+        ResultWriter results(options.output);
+
+        results.begin("host").field("cpus", static_cast<uint64_t>(thread::hardware_concurrency()))
+        .field("md5_kernel", md5MultiKernel()).field("md5_lanes", static_cast<uint64_t>(md5MultiLanes()))
+        .field("data_size", options.dataSize).field("repeats", static_cast<uint64_t>(options.repeats)).end();
+
+        if (enabled("kernel"))
+        {
+            benchmarkKernels(options, results);
+        }
+
+        if (enabled("pipeline") || enabled("scaling"))
+        {
+            benchmarkPipelines(options, results, enabled("pipeline"), enabled("scaling"));
+        }
+    }
+    catch (const exception &e)
+    {
+        cerr << "Error: " << e.what() << endl;
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,247 @@
+#include "blake3.h"
+
+#include <cstring>
+
+namespace
+{
+
+const uint32_t blake3Iv[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                              0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+const size_t blake3BlockLen = 64;
+const size_t blake3ChunkLen = 1024;
+
+enum : uint32_t
+{
+    ChunkStart = 1,
+    ChunkEnd = 2,
+    Parent = 4,
+    Root = 8
+};
+
+inline uint32_t blake3Rotr(uint32_t x, int s)
+{
+    return (x >> s) | (x << (32 - s));
+}
+
+inline void blake3G(uint32_t *v, int a, int b, int c, int d, uint32_t x, uint32_t y)
+{
+    v[a] += v[b] + x;
+    v[d] = blake3Rotr(v[d] ^ v[a], 16);
+    v[c] += v[d];
+    v[b] = blake3Rotr(v[b] ^ v[c], 12);
+    v[a] += v[b] + y;
+    v[d] = blake3Rotr(v[d] ^ v[a], 8);
+    v[c] += v[d];
+    v[b] = blake3Rotr(v[b] ^ v[c], 7);
+}
+
+/**
+ * @brief      Compression function, returns the new chaining value.
+ */
+void blake3Compress(uint32_t cv[8], const uint8_t block[blake3BlockLen], uint64_t counter,
+                    uint32_t blockLen, uint32_t flags)
+{
+    static const uint8_t permutation[16] = {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8};
+    uint32_t m[16], v[16];
+
+    for (int i = 0; i < 16; ++i)
+    {
+        const uint8_t *p = block + 4 * i;
+        m[i] = static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+               static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+    }
+
+    memcpy(v, cv, 8 * sizeof(uint32_t));
+    memcpy(v + 8, blake3Iv, 4 * sizeof(uint32_t));
+    v[12] = static_cast<uint32_t>(counter);
+    v[13] = static_cast<uint32_t>(counter >> 32);
+    v[14] = blockLen;
+    v[15] = flags;
+
+    for (int round = 0; round < 7; ++round)
+    {
+        blake3G(v, 0, 4, 8, 12, m[0], m[1]);
+        blake3G(v, 1, 5, 9, 13, m[2], m[3]);
+        blake3G(v, 2, 6, 10, 14, m[4], m[5]);
+        blake3G(v, 3, 7, 11, 15, m[6], m[7]);
+        blake3G(v, 0, 5, 10, 15, m[8], m[9]);
+        blake3G(v, 1, 6, 11, 12, m[10], m[11]);
+        blake3G(v, 2, 7, 8, 13, m[12], m[13]);
+        blake3G(v, 3, 4, 9, 14, m[14], m[15]);
+
+        uint32_t permuted[16];
+
+        for (int i = 0; i < 16; ++i)
+        {
+            permuted[i] = m[permutation[i]];
+        }
+
+        memcpy(m, permuted, sizeof(m));
+    }
+
+    for (int i = 0; i < 8; ++i)
+    {
+        cv[i] = v[i] ^ v[i + 8];
+    }
+}
+
+/**
+ * @brief      Hashes one chunk, the last block is compressed with extra flags.
+ */
+void blake3Chunk(const uint8_t *data, size_t len, uint64_t counter, uint32_t lastFlags, uint32_t cv[8])
+{
+    memcpy(cv, blake3Iv, sizeof(blake3Iv));
+    uint32_t flags = ChunkStart;
+
+    for (; len > blake3BlockLen; len -= blake3BlockLen, data += blake3BlockLen)
+    {
+        blake3Compress(cv, data, counter, blake3BlockLen, flags);
+        flags = 0;
+    }
+
+    uint8_t last[blake3BlockLen] = {};
+    memcpy(last, data, len);
+    blake3Compress(cv, last, counter, static_cast<uint32_t>(len), flags | ChunkEnd | lastFlags);
+}
+
+void blake3Parent(const uint32_t left[8], const uint32_t right[8], uint32_t flags, uint32_t cv[8])
+{
+    uint8_t block[blake3BlockLen];
+
+    for (int i = 0; i < 8; ++i)
+    {
+        for (int b = 0; b < 4; ++b)
+        {
+            block[4 * i + b] = static_cast<uint8_t>(left[i] >> (8 * b));
+            block[32 + 4 * i + b] = static_cast<uint8_t>(right[i] >> (8 * b));
+        }
+    }
+
+    memcpy(cv, blake3Iv, sizeof(blake3Iv));
+    blake3Compress(cv, block, 0, blake3BlockLen, Parent | flags);
+}
+
+/**
+ * @brief      Hashes subtree of whole chunks, left subtree holds the largest power of 2 chunks.
+ */
+void blake3Subtree(const uint8_t *data, size_t len, uint64_t counter, uint32_t rootFlag, uint32_t cv[8])
+{
+    if (len <= blake3ChunkLen)
+    {
+        blake3Chunk(data, len, counter, rootFlag, cv);
+        return;
+    }
+
+    size_t leftChunks = 1;
+
+    while (leftChunks * 2 * blake3ChunkLen < len)
+    {
+        leftChunks *= 2;
+    }
+
+    size_t leftLen = leftChunks * blake3ChunkLen;
+    uint32_t left[8], right[8];
+    blake3Subtree(data, leftLen, counter, 0, left);
+    blake3Subtree(data + leftLen, len - leftLen, counter + leftChunks, 0, right);
+    blake3Parent(left, right, rootFlag, cv);
+}
+
+/**
+ * @brief      Stores chaining value as little-endian digest.
+ */
+void blake3Store(const uint32_t cv[8], uint8_t out[32])
+{
+    for (int i = 0; i < 8; ++i)
+    {
+        for (int b = 0; b < 4; ++b)
+        {
+            out[4 * i + b] = static_cast<uint8_t>(cv[i] >> (8 * b));
+        }
+    }
+}
+
+} // namespace
+
+void blake3(const void *data, size_t len, uint8_t out[32])
+{
+    uint32_t cv[8];
+    blake3Subtree(static_cast<const uint8_t *>(data), len, 0, Root, cv);
+    blake3Store(cv, out);
+}
+
+Blake3Stream::Blake3Stream()
+{
+    memcpy(_cv, blake3Iv, sizeof(blake3Iv));
+}
+
+void Blake3Stream::update(const void *data, size_t len)
+{
+    auto bytes = static_cast<const uint8_t *>(data);
+
+    while (len > 0)
+    {
+        if (_blocksCompressed * blake3BlockLen + _blockLen == blake3ChunkLen) // more data follows the full chunk
+        {
+            uint32_t cv[8];
+            memcpy(cv, _cv, sizeof(cv));
+            blake3Compress(cv, _block, _chunkCounter, blake3BlockLen, ChunkEnd);
+
+            // every completed pair of subtrees is merged, so the stack holds set bits of the chunk count
+            uint64_t chunks = ++_chunkCounter;
+
+            for (; (chunks & 1) == 0; chunks >>= 1)
+            {
+                blake3Parent(_stack[--_stackSize], cv, 0, cv);
+            }
+
+            memcpy(_stack[_stackSize++], cv, sizeof(cv));
+            memcpy(_cv, blake3Iv, sizeof(blake3Iv));
+            _blocksCompressed = 0;
+            _blockLen = 0;
+        }
+
+        if (_blockLen == blake3BlockLen) // more data follows the full block
+        {
+            uint32_t flags = _blocksCompressed == 0 ? static_cast<uint32_t>(ChunkStart) : 0;
+            blake3Compress(_cv, _block, _chunkCounter, blake3BlockLen, flags);
+            ++_blocksCompressed;
+            _blockLen = 0;
+        }
+
+        size_t take = len < blake3BlockLen - _blockLen ? len : blake3BlockLen - _blockLen;
+        memcpy(_block + _blockLen, bytes, take);
+        _blockLen += take;
+        bytes += take;
+        len -= take;
+    }
+}
+
+void Blake3Stream::finish(uint8_t out[32])
+{
+    uint32_t cv[8];
+    uint8_t last[blake3BlockLen] = {};
+    uint32_t flags = ChunkEnd;
+
+    if (_blocksCompressed == 0)
+    {
+        flags |= ChunkStart;
+    }
+
+    if (_stackSize == 0)
+    {
+        flags |= Root;
+    }
+
+
+    memcpy(cv, _cv, sizeof(cv));
+    memcpy(last, _block, _blockLen);
+    blake3Compress(cv, last, _chunkCounter, static_cast<uint32_t>(_blockLen), flags);
+
+    // right edge of the tree is merged from the bottom, the top parent is the root
+    for (size_t i = _stackSize; i > 0; --i)
+    {
+        blake3Parent(_stack[i - 1], cv, i == 1 ? static_cast<uint32_t>(Root) : 0, cv);
+    }
+
+    blake3Store(cv, out);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief      Calculates BLAKE3 digest of default length in unkeyed mode.
+ *
+ * @param[in]  data  The data.
+ * @param[in]  len   The data length in bytes.
+ * @param      out   The raw digest, 32 bytes.
+ */
+void blake3(const void *data, size_t len, uint8_t out[32]);
+
+/**
+ * @brief      BLAKE3 of data fed by parts, digest is the same as blake3() of their concatenation.
+ *
+ * Chaining values of complete subtrees are kept on a stack and merged as soon
+ * as the next chunk shows they are not the right edge of the tree.
+ */
+class Blake3Stream
+{
+public:
+    Blake3Stream();
+
+    /**
+     * @brief      Hashes the next part of data.
+     *
+     * @param[in]  data  The data.
+     * @param[in]  len   The data length in bytes.
+     */
+    void update(const void *data, size_t len);
+
+    /**
+     * @brief      Gets the digest.
+     *
+     * @param      out   The raw digest, 32 bytes.
+     */
+    void finish(uint8_t out[32]);
+private:
+    uint32_t _cv[8];              // chaining value of the current chunk
+    uint8_t _block[64];           // last block of the current chunk, compressed when more data comes
+    size_t _blockLen = 0;
+    size_t _blocksCompressed = 0; // blocks of the current chunk before _block
+    uint64_t _chunkCounter = 0;   // index of the current chunk
+    uint32_t _stack[54][8];       // chaining values of complete subtrees, 2^54 chunks cover any input
+    size_t _stackSize = 0;
+};
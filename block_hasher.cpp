@@ -1,196 +1,553 @@
 #include "block_hasher.h"
-#include "md5.h"
+#include "checkpoint.h"
+#include "md5_mb.h"
 
 #include <exception>
 #include <thread>
-#include <fstream>
 #include <utility>
 #include <functional>
+#include <future>
+#include <map>
+#include <mutex>
 #include <algorithm>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <sys/mman.h>
 
 using namespace std;
 
-static pair<shared_ptr<ifstream>, shared_ptr<ofstream>> openFiles(const string &inputFile, const string &outputFile)
+/**
+ * @brief      Checks that all bytes are zero.
+ */
+static bool isZero(const uint8_t *data, size_t size)
 {
-    auto input = make_shared<ifstream>(inputFile, ios::binary);
-    auto output = make_shared<ofstream>(outputFile, ios::app);
+    size_t head = min(size, static_cast<size_t>(16));
 
-    if (!input->is_open())
+    for (size_t i = 0; i < head; ++i)
     {
-        throw invalid_argument("cannot open file " + inputFile);
+        if (data[i] != 0)
+        {
+            return false;
+        }
     }
 
-    if (!output->is_open())
+    // zero head shifted along the block, vectorized memcmp() stops at the first difference
+    return memcmp(data, data + head, size - head) == 0;
+}
+
+void BlockHasher::prepareZeroBlock()
+{
+    if (!_zeroBlock)
+    {
+        // anonymous read-only mapping takes no memory, all its pages are the shared zero page
+        size_t length = max(_size, static_cast<size_t>(1));
+        void *ptr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (ptr == MAP_FAILED)
+        {
+            throw bad_alloc();
+        }
+
+        _zeroBlock = shared_ptr<uint8_t>(static_cast<uint8_t *>(ptr), [length](uint8_t *p) { munmap(p, length); });
+    }
+}
+
+Digest BlockHasher::zeroDigest() const
+{
+    static mutex lock;
+    static map<pair<HashAlgorithm, size_t>, Digest> digests; // by algorithm and block size
+    lock_guard<mutex> guard(lock);
+    auto found = digests.find(make_pair(_algorithm, _size));
+
+    if (found == digests.end())
     {
-        throw invalid_argument("cannot open file " + outputFile);
+        Digest digest;
+        const uint8_t *data = _zeroBlock.get();
+        _hashBatch(&data, &_size, 1, &digest);
+        found = digests.emplace(make_pair(_algorithm, _size), digest).first;
     }
 
-    return make_pair(input, output);
+    return found->second;
 }
 
-SingleThreadHasher::SingleThreadHasher(size_t blockSize) : BlockHasher(blockSize)
+void BlockHasher::setNuma(bool enabled)
 {
+    _placement = enabled ? make_shared<CpuPlacement>(workersReadBlocks()) : nullptr;
+    _nodeBuffers.clear();
+
+    for (size_t node = 0; _placement && node < _placement->nodeCount(); ++node)
+    {
+        // buffers are allocated on demand, so a node pool takes memory only when its threads use it
+        _nodeBuffers.push_back(BufferPool::create(_buffers->getBufferSize(), _buffers->getMaxBuffers(),
+                                                  _buffers->getHugePages(), _placement->nodeId(node)));
+    }
 }
 
-void SingleThreadHasher::Hash(const string &inputFile, const string &outputFile)
+void BlockHasher::setFileDigest(bool enabled)
 {
-    auto [input, output] = openFiles(inputFile, outputFile);
-    auto data = make_shared<Buffer>(_size);
+    if (enabled && !supportsFileDigest())
+    {
+        throw invalid_argument("whole-file digest is not available with this engine");
+    }
 
-    while (true)
+    if (enabled != _fileDigestEnabled && _buffers)
     {
-        size_t count = input->readsome(reinterpret_cast<char *>(data->get()), data->getCapacity());
-        data->setSize(count);
-        *output << md5(data->get(), data->getSize()) << endl;
+        // batches queued for the file digest keep their buffers
+        size_t extra = FileDigest::queueDepth * md5MultiLanes();
+        size_t maxBuffers = _buffers->getMaxBuffers() + (enabled ? extra : 0) - (enabled ? 0 : extra);
+        _buffers = BufferPool::create(_buffers->getBufferSize(), maxBuffers, _buffers->getHugePages());
 
-        if (count < data->getCapacity())
+        if (_placement)
         {
-            break;
+            setNuma(true); // node pools follow the main pool
         }
+    }
+
+    _fileDigestEnabled = enabled;
+}
+
+void BlockHasher::startFileDigest(const string &inputFile)
+{
+    _fileDigest.reset();
 
-        data = make_shared<Buffer>(_size);
+    if (_fileDigestEnabled)
+    {
+        _fileDigest = make_unique<FileDigest>(inputFile, _firstBlock * _size);
     }
 }
 
-MultiThreadHasher::MultiThreadHasher(size_t blockSize, size_t threads) :
-    BlockHasher(blockSize)
+void BlockHasher::finishFileDigest(SignatureWriter &output)
 {
-    _threads = max(static_cast<size_t>(1), threads);
+    if (_fileDigest)
+    {
+        output.setFileDigest(_fileDigest->finish());
+        _fileDigest.reset();
+    }
 }
 
-void MultiThreadHasher::Hash(const std::string &inputFile, const std::string &outputFile)
+shared_ptr<SignatureWriter> BlockHasher::openOutput(const string &inputFile, const string &outputFile)
 {
-    auto [input, output] = openFiles(inputFile, outputFile);
-    auto data = make_shared<Buffer>(_size); // buffer for data to process by one thread
+    _firstBlock = _range.first;
 
-    _run = true;
-    thread writer(&MultiThreadHasher::writerThread, this, output);
+    if (_verifier)
+    {
+        return _verifier;
+    }
 
-    try // exception handling needed for joining to writer thread
+    if (_checkpointInterval <= 0)
     {
-        while (true)
+        // shard is a new signature of its own range
+        auto output = SignatureWriter::create(outputFile, _format, _algorithm, _size,
+                                              !_fileDigestEnabled && !_shard, _flushInterval, _tree);
+        tagShard(*output, inputFile);
+        return output;
+    }
+
+    Checkpoint checkpoint, saved;
+    checkpoint.input = InputIdentity::of(inputFile);
+    checkpoint.algorithm = _algorithm;
+    checkpoint.blockSize = _size;
+    checkpoint.format = _format;
+    checkpoint.tree = _tree;
+    checkpoint.rangeFirst = _range.first;
+    checkpoint.rangeBlocks = _range.count;
+    string checkpointFile = Checkpoint::fileName(outputFile);
+    shared_ptr<SignatureWriter> output;
+
+    if (_resume && saved.load(checkpointFile))
+    {
+        if (!saved.sameRun(checkpoint))
         {
-            // Read data from file to buffer and add to processing queue.
-            // Reading data for all threads at once is not always memory efficient but
-            // can be faster with large block size.
-            size_t count = input->readsome(reinterpret_cast<char *>(data->get()), data->getCapacity());
-            data->setSize(count);
-            addHasherThread(data);
+            throw runtime_error("input or signature options differ from checkpoint " + checkpointFile);
+        }
 
-            if (_exceptOccurred ||               // exit cycle if exception was thrown
-                    count < data->getCapacity()) // last segment processed
-            {
-                break;
-            }
+        // torn tail written after the checkpoint is cut off
+        output = SignatureWriter::resume(outputFile, _format, _algorithm, _size, saved.written, _flushInterval, _tree);
+        checkpoint.written = saved.written;
+        _firstBlock = _range.first + saved.written.blockCount;
+    }
+    else
+    {
+        output = SignatureWriter::create(outputFile, _format, _algorithm, _size, false, _flushInterval, _tree);
+    }
+
+    output = make_shared<CheckpointWriter>(output, checkpoint, checkpointFile, _checkpointInterval);
+    tagShard(*output, inputFile);
+    return output;
+}
+
+void BlockHasher::tagShard(SignatureWriter &output, const string &inputFile) const
+{
+    if (_shard)
+    {
+        output.setShard(_range.first, _size, FileHandle(inputFile).size());
+    }
+}
+
+shared_ptr<Buffer> BlockHasher::holeBlock(size_t length) const
+{
+    auto block = make_shared<Buffer>(_zeroBlock.get(), _size);
+    block->setSize(length);
+    block->setHole(true);
+    return block;
+}
+
+vector<Digest> BlockHasher::hashBlocks(const vector<shared_ptr<Buffer>> &blocks) const
+{
+    StageTimer timer(_stats.get(), Stage::Hash);
+    vector<const uint8_t *> data;
+    vector<size_t> lens;
+    vector<size_t> indexes; // positions of blocks needing hashing
+    vector<Digest> result(blocks.size());
+
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        const auto &block = blocks[i];
+        bool full = _size > 0 && block->getSize() == _size;
+
+        if (full && (block->isHole() || isZero(block->get(), _size)))
+        {
+            result[i] = zeroDigest();
+            continue;
+        }
+
+        data.push_back(block->get());
+        lens.push_back(block->getSize());
+        indexes.push_back(i);
+    }
+
+    if (_stats)
+    {
+        uint64_t bytes = 0;
+
+        for (const auto &block : blocks)
+        {
+            bytes += block->getSize();
+        }
+
+        _stats->addBlocks(blocks.size(), bytes);
+    }
+
+    if (indexes.size() == blocks.size())
+    {
+        _hashBatch(data.data(), lens.data(), data.size(), result.data());
+        return result;
+    }
+
+    vector<Digest> digests(data.size());
+    _hashBatch(data.data(), lens.data(), data.size(), digests.data());
+
+    for (size_t i = 0; i < indexes.size(); ++i)
+    {
+        result[indexes[i]] = digests[i];
+    }
+
+    return result;
+}
+
+bool BlockHasher::readBatch(FileHandle &input, SparseMap &holes, vector<shared_ptr<Buffer>> &batch)
+{
+    size_t lanes = md5MultiLanes();
+    batch.clear();
+
+    while (batch.size() < lanes)
+    {
+        if (_shard && input.position() / _size >= endBlock(input.size())) // shard is over
+        {
+            return true;
+        }
+
+        if (holes.isHole(input.position(), _size)) // whole block lies in a hole, it is not read
+        {
+            input.skip(_size);
+            _inputSize += _size;
+            batch.push_back(holeBlock(_size));
+            continue;
+        }
+
+        auto data = acquireBuffer();
+        size_t count;
 
-            data = make_shared<Buffer>(_size);
+        {
+            StageTimer timer(_stats.get(), Stage::Read);
+            count = input.read(data->get(), data->getCapacity());
         }
+
+        data->setSize(count);
+        _inputSize += count;
+        batch.push_back(data);
+
+        if (count < data->getCapacity()) // last segment read
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+SingleThreadHasher::SingleThreadHasher(size_t blockSize, bool hugePages) : BlockHasher(blockSize)
+{
+    _buffers = BufferPool::create(_size, md5MultiLanes(), hugePages); // one batch at a time
+}
+
+void SingleThreadHasher::Hash(const string &inputFile, const string &outputFile)
+{
+    FileHandle input(inputFile);
+    SparseMap holes(input.get(), input.size());
+    auto output = openOutput(inputFile, outputFile);
+    vector<shared_ptr<Buffer>> batch;
+    bool last = input.isRegular() && _firstBlock >= endBlock(input.size()); // resumed after the last block
+
+    input.skip(_firstBlock * _size);
+    _inputSize = min<uint64_t>(_firstBlock * _size, input.size()); // start of positioned input is not counted
+    prepareZeroBlock();
+    startFileDigest(inputFile);
+
+    if (_placement)
+    {
+        _placement->pinHome();
     }
-    catch (const exception &e)
+
+    while (!last)
     {
-        if (!_exceptOccurred)
+        // blocks are read by batches to fill all lanes of MD5 kernel
+        last = readBatch(input, holes, batch);
+        digestFile(batch);
+        auto digests = hashBlocks(batch);
+        StageTimer timer(_stats.get(), Stage::Write);
+
+        for (const auto &digest : digests)
         {
-            _exceptPtr = current_exception();
-            _exceptOccurred = true;
-            _writerCv.notify_all(); // notify writer to detect exception
+            output->write(digest);
         }
     }
 
-    _run = false;
+    finishFileDigest(*output);
+    output->finish(_inputSize);
+}
+
+MultiThreadHasher::MultiThreadHasher(size_t blockSize, size_t threads, bool hugePages) :
+    BlockHasher(blockSize),
+    _threads(max(static_cast<size_t>(1), threads)),
+    _pool(_threads, _threads) // completion ring never holds more than _threads tasks
+{
+    // batches of all threads plus the one being read
+    _buffers = BufferPool::create(_size, (_threads + 1) * md5MultiLanes(), hugePages);
+}
+
+void MultiThreadHasher::Hash(const std::string &inputFile, const std::string &outputFile)
+{
+    auto output = openOutput(inputFile, outputFile);
+
+    _inputSize = 0;
+    _exceptOccurred = false;
+    _exceptPtr = nullptr;
+    prepareZeroBlock();
+    _ring = make_unique<CompletionRing<vector<Digest>>>(_threads);
+
+    startFileDigest(inputFile);
+
+    if (_placement) // calling thread is the reader
+    {
+        _placement->pinHome();
+    }
+
+    thread writer(&MultiThreadHasher::writerThread, this, output);
+
+    try // exception handling needed for joining to writer thread
+    {
+        readBlocks(inputFile);
+    }
+    catch (...)
+    {
+        setException(current_exception());
+    }
+
+    if (_exceptOccurred)
+    {
+        _ring->abort(); // writer stops immediately for avoiding wrong data in output file
+    }
+    else
+    {
+        _ring->close(); // writer stops when all digests are written
+    }
 
     if (writer.joinable())
     {
         writer.join();
     }
 
+    _pool.wait(); // tasks use the ring
+
+    if (!_exceptOccurred)
+    {
+        try
+        {
+            finishFileDigest(*output);
+        }
+        catch (...)
+        {
+            setException(current_exception());
+        }
+    }
+
+    _fileDigest.reset(); // stops the thread after exception
+
     if (_exceptOccurred)
     {
         rethrow_exception(_exceptPtr); // current method is always in main thread so we can safely rethrow
     }
+
+    output->finish(_inputSize);
 }
 
-string MultiThreadHasher::hashOneBlock(shared_ptr<Buffer> data)
+void MultiThreadHasher::readBlocks(const string &inputFile)
 {
-    string result;
+    FileHandle input(inputFile);
+    SparseMap holes(input.get(), input.size());
+    vector<shared_ptr<Buffer>> batch; // blocks to process by one thread
 
-    try
+    input.skip(_firstBlock * _size);
+    _inputSize = min<uint64_t>(_firstBlock * _size, input.size()); // start of positioned input is not counted
+
+    if (input.isRegular() && _firstBlock >= endBlock(input.size())) // resumed after the last block
     {
-        result = md5(data->get(), data->getSize());
-        _writerCv.notify_all(); // notify writer to begin writing file
+        return;
     }
-    catch (...)
+
+    while (true)
+    {
+        // Read data from file to buffers and add to processing queue.
+        // Every thread hashes a batch of blocks in lanes of MD5 kernel, buffers
+        // return to the pool after hashing, so (threads + 1) * lanes * blockSize
+        // bytes are held in memory. It is not always memory efficient but
+        // can be faster with large block size, StreamingHasher keeps only
+        // parts of blocks when it is too much.
+        bool last = readBatch(input, holes, batch);
+        addHasherTask(move(batch));
+
+        if (_exceptOccurred || // exit cycle if exception was thrown
+                last)          // last segment processed
+        {
+            break;
+        }
+
+        batch = vector<shared_ptr<Buffer>>();
+    }
+}
+
+void MultiThreadHasher::setException(exception_ptr exception)
+{
+    bool expected = false;
+
+    if (_exceptOccurred.compare_exchange_strong(expected, true))
     {
-        _writerCv.notify_all(); // notify writer to detect exception
-        throw;
+        _exceptPtr = exception; // read only by main thread after all threads are finished
     }
+}
 
-    return result;
+void MultiThreadHasher::addHasherTask(vector<shared_ptr<Buffer>> batch)
+{
+    digestFile(batch); // batches are submitted in file order
+    // buffers are released right after hashing
+    addHasherTask([this, batch = make_shared<vector<shared_ptr<Buffer>>>(move(batch))]()
+    {
+        auto digests = hashBlocks(*batch);
+        batch->clear();
+        return digests;
+    });
 }
 
-void MultiThreadHasher::addHasherThread(shared_ptr<Buffer> data)
+void MultiThreadHasher::addHasherTask(function<vector<Digest>()> task)
 {
     // this method is only used in main method Hash
     // so we don't need to redirect exceptions to eptr
-    unique_lock<mutex> locker(_m);
+    uint64_t seq;
+    bool reserved;
 
-    _readerCv.wait(locker, [this]() { return this->_resultQueue.size() < _threads; }); // waiting a future to finish and free memory
-    _resultQueue.push(async(launch::async, &MultiThreadHasher::hashOneBlock, this, data));
-}
+    {
+        StageTimer timer(_stats.get(), Stage::ReaderWait);
+        reserved = _ring->reserve(seq); // waiting for the writer to free a slot
+    }
 
-void MultiThreadHasher::writerThread(shared_ptr<ostream> output)
-{
-    auto pred = [this]()
+    if (!reserved)
     {
-        // if exception occured before any items was inserted to queue,
-        // we need to awake writer and make it jump over _resultQueue.front().wait()
-        if (_exceptOccurred)
+        return; // aborted, exception flag is already set
+    }
+
+    _pool.post([this, seq, task = move(task)]()
+    {
+        if (_placement)
         {
-            rethrow_exception(_exceptPtr);
+            _placement->pinWorker();
         }
 
-        return !this->_resultQueue.empty();
-    };
+        try
+        {
+            _ring->publish(seq, task());
+        }
+        catch (...)
+        {
+            _ring->fail(seq, current_exception()); // writer rethrows it in order
+        }
+    });
+}
+
+void MultiThreadHasher::runParallel(const vector<function<void()>> &tasks)
+{
+    vector<future<void>> results;
+
+    for (const auto &task : tasks)
+    {
+        results.push_back(_pool.submit(task));
+    }
+
+    for (auto &result : results)
+    {
+        result.wait(); // all tasks finish before an exception leaves, they may use caller data
+    }
+
+    for (auto &result : results)
+    {
+        result.get();
+    }
+}
+
+void MultiThreadHasher::writerThread(shared_ptr<SignatureWriter> output)
+{
+    if (_placement)
+    {
+        _placement->pinHome();
+    }
 
     try
     {
-        string hash;
-        while (_run)
+        vector<Digest> digests;
+
+        while (true)
         {
             {
-                unique_lock<mutex> locker(_m);
+                StageTimer timer(_stats.get(), Stage::WriterWait);
 
-                _writerCv.wait(locker, pred);
-                _resultQueue.front().wait();
-
-                if (_exceptOccurred)
+                if (!_ring->next(digests))
                 {
-                    _readerCv.notify_all(); // awake sleeping thread to detect exception
-                    return; // immediatly return for avoiding wrong data in output file
+                    break;
                 }
+            }
 
-                hash = _resultQueue.front().get();
-                _resultQueue.pop();
-                _readerCv.notify_all();
-            } // end of mutex-blocking code, file output witout block
-
-            *output << hash << endl;
-        }
+            StageTimer timer(_stats.get(), Stage::Write);
 
-        while (!_resultQueue.empty())
-        {
-            _resultQueue.front().wait();
-            *output << _resultQueue.front().get() << endl;
-            _resultQueue.pop();
+            for (const auto &digest : digests)
+            {
+                output->write(digest);
+            }
         }
     }
-    catch (const exception &e)
+    catch (...)
     {
-        if (!_exceptOccurred)
-        {
-            _exceptPtr = current_exception();
-            _exceptOccurred = true;
-        }
-
-        _readerCv.notify_all(); // awake sleeping thread to detect exception
+        setException(current_exception());
+        _ring->abort(); // awake sleeping reader to detect exception
     }
 }
@@ -1,15 +1,26 @@
 #pragma once
 
+#include <algorithm>
 #include <string>
-#include <future>
-#include <mutex>
-#include <condition_variable>
-#include <queue>
 #include <cstdint>
-#include <ostream>
 #include <atomic>
 #include <memory>
 #include <exception>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "buffer_pool.h"
+#include "completion_ring.h"
+#include "cpu_placement.h"
+#include "file_digest.h"
+#include "file_handle.h"
+#include "pipeline_stats.h"
+#include "shard.h"
+#include "signature.h"
+#include "signature_verifier.h"
+#include "sparse_map.h"
+#include "thread_pool.h"
 
 /**
  * @brief      Abstract class for block hasher.
@@ -23,50 +34,284 @@ public:
      * @param[in]  blockSize  The block size in bytes.
      */
     BlockHasher(size_t blockSize) : _size(blockSize) {}
+    virtual ~BlockHasher() = default;
     virtual void Hash(const std::string &inputFile, const std::string &outputFile) = 0;
+
+    /**
+     * @brief      Sets the output signature format, text is used by default.
+     *
+     * @param[in]  format  The format.
+     */
+    void setFormat(SignatureFormat format)
+    {
+        _format = format;
+    }
+
+    /**
+     * @brief      Sets how often signature output is flushed.
+     *
+     * @param[in]  blocks  Flush every this number of blocks, 0 to flush only when output buffer is full.
+     */
+    void setFlushInterval(size_t blocks)
+    {
+        _flushInterval = blocks;
+    }
+
+    /**
+     * @brief      Sets the block hash algorithm, MD5 is used by default.
+     *
+     * @param[in]  algorithm  The algorithm.
+     */
+    void setAlgorithm(HashAlgorithm algorithm)
+    {
+        _algorithm = algorithm;
+        _hashBatch = hashBatchFunc(algorithm);
+    }
+
+    /**
+     * @brief      Makes Hash() compare digests with existing signature instead of writing output file.
+     *
+     * @param[in]  verifier  The verifier, nullptr to write signature again.
+     */
+    void setVerifier(std::shared_ptr<SignatureVerifier> verifier)
+    {
+        _verifier = std::move(verifier);
+    }
+
+    /**
+     * @brief      Sets Merkle tree stored in signature after the digests, none by default.
+     *
+     * @param[in]  tree  The tree mode.
+     */
+    void setTree(TreeMode tree)
+    {
+        _tree = tree;
+    }
+
+    /**
+     * @brief      Makes Hash() record counters and stage latencies, nothing is measured by default.
+     *
+     * @param[in]  stats  The statistics, nullptr to stop measuring.
+     */
+    void setStats(std::shared_ptr<PipelineStats> stats)
+    {
+        _stats = std::move(stats);
+    }
+
+    /**
+     * @brief      Binds threads to NUMA nodes and allocates buffers on the node of the thread using them.
+     *
+     * @param[in]  enabled  Enable placement, threads float freely by default.
+     */
+    void setNuma(bool enabled);
+
+    /**
+     * @brief      Makes Hash() record checkpoints, so an interrupted run can be resumed.
+     *
+     * Checkpointed signature is written from scratch instead of being appended.
+     *
+     * @param[in]  interval  Seconds between checkpoints, 0 to disable.
+     * @param[in]  resume    Continue after checkpoint of interrupted run if there is one.
+     */
+    void setCheckpoint(double interval, bool resume)
+    {
+        _checkpointInterval = interval;
+        _resume = resume;
+    }
+
+    /**
+     * @brief      Makes Hash() compute whole-file MD5 from the blocks it reads and store it as signature trailer.
+     *
+     * Blocks must be read in file order by the reader, hashers whose workers
+     * read their own blocks do not support it. Signature with file digest is
+     * never appended.
+     *
+     * @param[in]  enabled  Compute the file digest, nothing is computed by default.
+     */
+    void setFileDigest(bool enabled);
+
+    /**
+     * @brief      Makes Hash() write shard signature of a range of blocks instead of the whole input.
+     *
+     * Shard signature is tagged with its first block, block size and input
+     * size, so shards of a run are merged by mergeShards() of shard.h.
+     *
+     * @param[in]  range  The blocks to hash, the whole input is hashed by default.
+     */
+    void setShard(const ShardRange &range)
+    {
+        _range = range;
+        _shard = true;
+    }
+
+    /**
+     * @brief      Gets index of the first block hashed by the last Hash(), positive if it was resumed or sharded.
+     */
+    uint64_t firstBlock() const
+    {
+        return _firstBlock;
+    }
 protected:
     size_t _size; // block size in bytes
+    std::shared_ptr<BufferPool> _buffers; // recycled buffers for blocks
+    SignatureFormat _format = SignatureFormat::Text; // output signature format
+    uint64_t _inputSize = 0; // number of bytes read from input
+    size_t _flushInterval = 0; // number of blocks between output flushes
+    HashAlgorithm _algorithm = HashAlgorithm::Md5; // block hash algorithm
+    HashBatchFunc _hashBatch = hashBatchFunc(HashAlgorithm::Md5); // hashing loop of the algorithm
+    std::shared_ptr<SignatureVerifier> _verifier; // replaces output in verify mode
+    TreeMode _tree = TreeMode::None; // Merkle tree stored in signature
+    std::shared_ptr<uint8_t> _zeroBlock; // read-only zero pages of block size standing for holes
+    std::shared_ptr<PipelineStats> _stats; // stage measurements, may be null
+    std::shared_ptr<CpuPlacement> _placement; // NUMA placement of threads, may be null
+    std::vector<std::shared_ptr<BufferPool>> _nodeBuffers; // buffers by node index of placement
+    double _checkpointInterval = 0; // seconds between checkpoints, 0 if disabled
+    bool _resume = false; // continue after checkpoint
+    uint64_t _firstBlock = 0; // blocks before it are in signature of interrupted run
+    bool _fileDigestEnabled = false; // compute whole-file digest
+    std::unique_ptr<FileDigest> _fileDigest; // file digest of the running Hash(), may be null
+    bool _shard = false;  // hash only _range and tag signature as shard
+    ShardRange _range;    // blocks of shard
 
     /**
-     * @brief      Simple class for buffer with size and capacity.
+     * @brief      Opens signature writer of configured format, or gets verifier in verify mode.
+     *
+     * Sets _firstBlock to the first block of shard, or to the block following
+     * durable part of signature when the run is resumed, hashing must start from it.
+     *
+     * @param[in]  inputFile   The input file.
+     * @param[in]  outputFile  The output file.
+     *
+     * @return     The writer.
      */
-    class Buffer
+    virtual std::shared_ptr<SignatureWriter> openOutput(const std::string &inputFile, const std::string &outputFile);
+
+    /**
+     * @brief      Tags output as shard of input when a shard is hashed.
+     *
+     * @param      output     The signature writer.
+     * @param[in]  inputFile  The input file.
+     */
+    void tagShard(SignatureWriter &output, const std::string &inputFile) const;
+
+    /**
+     * @brief      Gets index after the last block to hash, the end of the input or of the shard.
+     *
+     * @param[in]  inputSize  The input size in bytes.
+     */
+    uint64_t endBlock(uint64_t inputSize) const
     {
-    public:
-        Buffer(size_t capacity) : _capacity(capacity)
-        {
-            _ptr = new uint8_t[capacity];
-        }
-        ~Buffer()
-        {
-            delete[] _ptr;
-        }
+        uint64_t blocks = _size > 0 ? inputSize / _size + 1 : 1; // last block may be empty
+        return _range.count < blocks - std::min(_range.first, blocks) ? _range.first + _range.count : blocks;
+    }
 
-        uint8_t *get()
-        {
-            return _ptr;
-        }
+    /**
+     * @brief      Tells whether hash workers read their blocks themselves, so they can be spread over nodes.
+     */
+    virtual bool workersReadBlocks() const
+    {
+        return false;
+    }
 
-        void setSize(size_t newSize)
-        {
-            _dataSize = newSize < _capacity ? newSize : _capacity;
-        }
+    /**
+     * @brief      Starts file digest of input when enabled, called after openOutput().
+     *
+     * Blocks before _firstBlock are read by the file digest itself.
+     *
+     * @param[in]  inputFile  The input file.
+     */
+    void startFileDigest(const std::string &inputFile);
 
-        size_t getSize() const
+    /**
+     * @brief      Hands blocks read in file order over to the file digest if it is running.
+     *
+     * @param[in]  batch  The blocks.
+     */
+    void digestFile(const std::vector<std::shared_ptr<Buffer>> &batch)
+    {
+        if (_fileDigest)
         {
-            return _dataSize;
+            _fileDigest->add(batch);
         }
+    }
 
-        size_t getCapacity() const
-        {
-            return _capacity;
-        }
+    /**
+     * @brief      Waits for the file digest if it is running and passes it to the output.
+     *
+     * @param      output  The signature writer.
+     */
+    void finishFileDigest(SignatureWriter &output);
+
+    /**
+     * @brief      Tells whether whole-file digest can be computed.
+     *
+     * All blocks must pass readBatch() or addHasherTask() of a batch in file order.
+     */
+    virtual bool supportsFileDigest() const
+    {
+        return true;
+    }
 
-    private:
-        uint8_t *_ptr;
-        size_t _dataSize = 0;
-        size_t _capacity;
-    };
+    /**
+     * @brief      Maps zero block, called before hashing.
+     */
+    void prepareZeroBlock();
+
+    /**
+     * @brief      Gets digest of full zero block, it is hashed at the first hole or zero block.
+     *
+     * Digest is cached per algorithm and block size for the whole process, so
+     * inputs without holes never pay for hashing a huge zero block.
+     *
+     * @return     The digest.
+     */
+    Digest zeroDigest() const;
+
+    /**
+     * @brief      Creates block of zeros standing for a hole of the input, nothing is read for it.
+     *
+     * @param[in]  length  The block length, at most block size.
+     *
+     * @return     The block.
+     */
+    std::shared_ptr<Buffer> holeBlock(size_t length) const;
+
+    /**
+     * @brief      Takes a free buffer from the pool of node of calling thread, waits while all are in use.
+     *
+     * @return     The buffer.
+     */
+    std::shared_ptr<Buffer> acquireBuffer() const
+    {
+        StageTimer timer(_stats.get(), Stage::BufferWait);
+        return _placement ? _nodeBuffers[_placement->currentNode()]->acquire() : _buffers->acquire();
+    }
+
+    /**
+     * @brief      Hashes several blocks at once with the selected algorithm.
+     *
+     * MD5 blocks are hashed together in lanes of multi-lane kernel. Full blocks
+     * of holes and of zero data get the cached zero digest without hashing.
+     *
+     * @param[in]  blocks  The blocks.
+     *
+     * @return     Digests in the same order as blocks.
+     */
+    std::vector<Digest> hashBlocks(const std::vector<std::shared_ptr<Buffer>> &blocks) const;
+
+    /**
+     * @brief      Reads blocks from input stream until batch is full or input is over.
+     *
+     * Every block is filled with as many reads as needed, so short reads of
+     * pipes do not end it early. Blocks lying in holes of the input are skipped.
+     *
+     * @param      input  The input.
+     * @param      holes  Holes of the input.
+     * @param      batch  The batch to fill, cleared before reading.
+     *
+     * @return     True if the last block was read.
+     */
+    bool readBatch(FileHandle &input, SparseMap &holes, std::vector<std::shared_ptr<Buffer>> &batch);
 };
 
 /**
@@ -75,7 +320,13 @@ protected:
 class SingleThreadHasher : public BlockHasher
 {
 public:
-    SingleThreadHasher(size_t blockSize = 1024 * 1024);
+    /**
+     * @brief      Constructs the single thread hasher.
+     *
+     * @param[in]  blockSize  The block size in bytes.
+     * @param[in]  hugePages  Back block buffers with huge pages.
+     */
+    SingleThreadHasher(size_t blockSize = 1024 * 1024, bool hugePages = false);
     virtual void Hash(const std::string &inputFile, const std::string &outputFile) override;
 };
 
@@ -85,37 +336,71 @@ public:
 class MultiThreadHasher : public BlockHasher
 {
 public:
-    MultiThreadHasher(size_t blockSize = 1024 * 1024, size_t threads = 4);
+    /**
+     * @brief      Constructs the multi thread hasher.
+     *
+     * @param[in]  blockSize  The block size in bytes.
+     * @param[in]  threads    The number of hasher threads.
+     * @param[in]  hugePages  Back block buffers with huge pages.
+     */
+    MultiThreadHasher(size_t blockSize = 1024 * 1024, size_t threads = 4, bool hugePages = false);
     virtual void Hash(const std::string &inputFile, const std::string &outputFile) override;
-private:
-    size_t _threads;    // number of simultaneously processed threads
-    std::mutex _m;      // mutex for access to _resultQueue
-    std::queue<std::future<std::string>> _resultQueue; // queue of calculated hashes
-    std::condition_variable _writerCv, _readerCv; // condition variables to wake up reader and writer threads
-    std::atomic_bool _run;                        // run flag
-    std::exception_ptr _exceptPtr = nullptr;      // ptr for handling exceptions in threads
+protected:
     std::atomic_bool _exceptOccurred = false;     // exception flag
 
     /**
-     * @brief      Hashes data block.
+     * @brief      Reads input by batches and submits them with addHasherTask().
+     *
+     * Called in main thread while writer thread is running. Reading must stop
+     * when _exceptOccurred is set.
+     *
+     * @param[in]  inputFile  The input file.
+     */
+    virtual void readBlocks(const std::string &inputFile);
+
+    /**
+     * @brief      Submits batch to the thread pool, its digests go to the completion ring.
+     *
+     * @param[in]  batch  The blocks
+     */
+    void addHasherTask(std::vector<std::shared_ptr<Buffer>> batch);
+
+    /**
+     * @brief      Submits task to the thread pool, its digests go to the completion ring.
      *
-     * @param[in]  data  The data.
+     * Waits while the ring is full.
      *
-     * @return     Hash.
+     * @param[in]  task  The task returning digests of consecutive blocks.
      */
-    std::string hashOneBlock(std::shared_ptr<Buffer> data);
+    void addHasherTask(std::function<std::vector<Digest>()> task);
+
+    /**
+     * @brief      Runs tasks on hasher threads and waits for all of them.
+     *
+     * Used for work the reader needs done before it can submit batches.
+     *
+     * @param[in]  tasks  The tasks.
+     *
+     * @throws     The first exception thrown by a task.
+     */
+    void runParallel(const std::vector<std::function<void()>> &tasks);
+private:
+    size_t _threads;    // number of simultaneously processed threads
+    ThreadPool _pool;   // persistent hasher threads
+    std::unique_ptr<CompletionRing<std::vector<Digest>>> _ring; // digest batches in file order
+    std::exception_ptr _exceptPtr = nullptr;      // ptr for handling exceptions in threads
 
     /**
-     * @brief      Adds a hasher future to the queue.
+     * @brief      Stores the first exception and sets exception flag.
      *
-     * @param[in]  data  The data
+     * @param[in]  exception  The exception.
      */
-    void addHasherThread(std::shared_ptr<Buffer> data);
+    void setException(std::exception_ptr exception);
 
     /**
-     * @brief      Thread function for writing calculated hashes to stream.
+     * @brief      Thread function for writing calculated digests to signature.
      *
-     * @param[in]  output  Stream to write.
+     * @param[in]  output  Signature to write.
      */
-    void writerThread(std::shared_ptr<std::ostream> output);
+    void writerThread(std::shared_ptr<SignatureWriter> output);
 };
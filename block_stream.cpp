@@ -0,0 +1,117 @@
+#include "block_stream.h"
+#include "md5_mb.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+BlockStream::BlockStream(size_t blockSize, HashAlgorithm algorithm, Callback callback) :
+    _blockSize(blockSize),
+    _hashBatch(hashBatchFunc(algorithm)),
+    _callback(move(callback)),
+    _lanes(max(md5MultiLanes(), static_cast<size_t>(1)))
+{
+    if (_blockSize == 0)
+    {
+        throw invalid_argument("zero block size");
+    }
+
+    _staging.reset(new uint8_t[_lanes * _blockSize]);
+    _pointers.reset(new const uint8_t *[_lanes]);
+    _lengths.reset(new size_t[_lanes]);
+    _digests.reset(new Digest[_lanes]);
+}
+
+void BlockStream::addBlock(const uint8_t *data, size_t length)
+{
+    _pointers[_count] = data;
+    _lengths[_count] = length;
+
+    if (++_count == _lanes)
+    {
+        flush();
+    }
+}
+
+void BlockStream::flush()
+{
+    if (_count == 0)
+    {
+        return;
+    }
+
+    _hashBatch(_pointers.get(), _lengths.get(), _count, _digests.get());
+
+    for (size_t i = 0; i < _count; ++i)
+    {
+        _callback(_nextIndex + i, _digests[i]);
+    }
+
+    _nextIndex += _count;
+    _count = 0;
+}
+
+void BlockStream::update(const void *data, size_t length)
+{
+    if (_finished)
+    {
+        throw logic_error("update of finished block stream");
+    }
+
+    auto bytes = static_cast<const uint8_t *>(data);
+    bool direct = false; // batch points to data of this call
+    _size += length;
+
+    while (length > 0)
+    {
+        if (_filled == 0 && length >= _blockSize) // whole block is hashed in place
+        {
+            addBlock(bytes, _blockSize);
+            direct = _count > 0;
+            bytes += _blockSize;
+            length -= _blockSize;
+            continue;
+        }
+
+        // staging slot of the batch position keeps the block until it is complete
+        uint8_t *slot = _staging.get() + _count * _blockSize;
+        size_t part = min(length, _blockSize - _filled);
+        memcpy(slot + _filled, bytes, part);
+        _filled += part;
+        bytes += part;
+        length -= part;
+
+        if (_filled == _blockSize)
+        {
+            _filled = 0;
+            addBlock(slot, _blockSize);
+            direct = direct && _count > 0;
+        }
+    }
+
+    if (direct) // data may be reused by caller after return
+    {
+        size_t position = _count;
+        flush();
+
+        if (_filled > 0) // staged part moves with its batch position
+        {
+            memmove(_staging.get(), _staging.get() + position * _blockSize, _filled);
+        }
+    }
+}
+
+uint64_t BlockStream::finish()
+{
+    if (_finished)
+    {
+        throw logic_error("block stream is already finished");
+    }
+
+    _finished = true;
+    addBlock(_staging.get() + _count * _blockSize, _filled); // last block may be empty
+    flush();
+    return _nextIndex;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "hash_algorithm.h"
+
+/**
+ * @brief      Push-style block hashing of data coming in pieces of any size.
+ *
+ * Data is split into blocks of fixed size, every block digest is delivered to
+ * the callback in block order together with the block index. Whole blocks
+ * inside a piece are hashed in place, only blocks spanning pieces are copied.
+ * Blocks are hashed by batches filling all lanes of the multi-lane MD5 kernel.
+ *
+ * Memory is allocated only by the constructor, digests are passed as Digest
+ * values with inline storage, so hashing allocates nothing per block. Hex
+ * formatting is left to the output, see Digest::toHex().
+ *
+ * Block boundaries and digests are the same as in signatures of the
+ * blockHasher utility: finish() always delivers the last block, which is
+ * empty when the data size is a multiple of block size.
+ *
+ * Example:
+ * @code
+ * BlockStream stream(1024 * 1024, HashAlgorithm::Md5, [](uint64_t index, const Digest &digest)
+ * {
+ *     store(index, digest.data(), digest.size());
+ * });
+ * while (size_t length = receive(buffer, sizeof(buffer)))
+ * {
+ *     stream.update(buffer, length);
+ * }
+ * stream.finish();
+ * @endcode
+ */
+class BlockStream
+{
+public:
+    /**
+     * @brief      Receives digest of block, called from update() and finish() in block order.
+     */
+    typedef std::function<void(uint64_t blockIndex, const Digest &digest)> Callback;
+
+    /**
+     * @brief      Constructs the stream.
+     *
+     * @param[in]  blockSize  The block size in bytes, positive.
+     * @param[in]  algorithm  The hash algorithm.
+     * @param[in]  callback   The digest receiver.
+     *
+     * @throws     std::invalid_argument for zero block size.
+     */
+    BlockStream(size_t blockSize, HashAlgorithm algorithm, Callback callback);
+
+    BlockStream(const BlockStream &) = delete;
+    BlockStream &operator=(const BlockStream &) = delete;
+
+    /**
+     * @brief      Hashes the next piece of data.
+     *
+     * Digests of blocks completed by the piece are delivered before return, so
+     * the piece may be reused right after the call.
+     *
+     * @param[in]  data    The data.
+     * @param[in]  length  The length in bytes.
+     *
+     * @throws     std::logic_error after finish().
+     */
+    void update(const void *data, size_t length);
+
+    /**
+     * @brief      Hashes the last block and delivers all remaining digests.
+     *
+     * @return     Number of blocks of the stream.
+     *
+     * @throws     std::logic_error if called twice.
+     */
+    uint64_t finish();
+
+    /**
+     * @brief      Gets number of bytes passed to update().
+     */
+    uint64_t size() const
+    {
+        return _size;
+    }
+
+private:
+    size_t _blockSize;
+    HashBatchFunc _hashBatch;
+    Callback _callback;
+    size_t _lanes;                        // blocks in one batch
+    std::unique_ptr<uint8_t[]> _staging;  // slot of blockSize per batch position for blocks spanning pieces
+    std::unique_ptr<const uint8_t *[]> _pointers; // blocks of the batch
+    std::unique_ptr<size_t[]> _lengths;
+    std::unique_ptr<Digest[]> _digests;
+    size_t _count = 0;       // blocks in the batch
+    size_t _filled = 0;      // bytes of block being staged in slot _count
+    uint64_t _nextIndex = 0; // index of the first block of the batch
+    uint64_t _size = 0;
+    bool _finished = false;
+
+    void addBlock(const uint8_t *data, size_t length);
+    void flush();
+};
@@ -0,0 +1,106 @@
+#include "buffer_pool.h"
+#include "cpu_placement.h"
+
+#include <algorithm>
+#include <new>
+#include <sys/mman.h>
+
+using namespace std;
+
+static const size_t hugePageSize = 2 * 1024 * 1024;
+
+BufferPool::BufferPool(size_t bufferSize, size_t maxBuffers, bool hugePages, int node) :
+    _bufferSize(bufferSize),
+    _maxBuffers(max(static_cast<size_t>(1), maxBuffers)),
+    _hugePages(hugePages),
+    _node(node)
+{
+}
+
+BufferPool::~BufferPool()
+{
+    for (auto &buffer : _free)
+    {
+        delete buffer;
+    }
+
+    for (auto &chunk : _chunks)
+    {
+        munmap(chunk.ptr, chunk.length);
+    }
+}
+
+uint8_t *BufferPool::allocate()
+{
+    // mmap always returns page-aligned memory and pages are faulted in only once
+    // because buffers are recycled
+    size_t length = max(_bufferSize, static_cast<size_t>(1));
+    void *ptr = MAP_FAILED;
+
+    if (_hugePages)
+    {
+        length = (length + hugePageSize - 1) / hugePageSize * hugePageSize;
+#ifdef MAP_HUGETLB
+        ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+    }
+
+    if (ptr == MAP_FAILED) // no reserved huge pages, transparent ones are requested instead
+    {
+        ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (ptr == MAP_FAILED)
+        {
+            throw bad_alloc();
+        }
+
+#ifdef MADV_HUGEPAGE
+        if (_hugePages)
+        {
+            madvise(ptr, length, MADV_HUGEPAGE);
+        }
+#endif
+    }
+
+    if (_node >= 0) // pages are not touched yet, they are faulted in on the preferred node
+    {
+        preferNumaNode(ptr, length, _node);
+    }
+
+    _chunks.push_back({ptr, length});
+    return static_cast<uint8_t *>(ptr);
+}
+
+shared_ptr<Buffer> BufferPool::acquire()
+{
+    unique_lock<mutex> locker(_m);
+    Buffer *buffer = nullptr;
+
+    _freeCv.wait(locker, [this]() { return !_free.empty() || _allocated < _maxBuffers; });
+
+    if (!_free.empty())
+    {
+        buffer = _free.back();
+        _free.pop_back();
+    }
+    else
+    {
+        _chunks.reserve(_maxBuffers);
+        buffer = new Buffer(allocate(), _bufferSize);
+        ++_allocated;
+    }
+
+    buffer->setSize(0);
+    auto self = shared_from_this(); // pool must live while any buffer is in use
+    return shared_ptr<Buffer>(buffer, [self](Buffer *released) { self->release(released); });
+}
+
+void BufferPool::release(Buffer *buffer)
+{
+    {
+        lock_guard<mutex> locker(_m);
+        _free.push_back(buffer);
+    }
+
+    _freeCv.notify_one();
+}
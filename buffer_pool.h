@@ -0,0 +1,130 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief      Simple class for buffer with size and capacity.
+ */
+class Buffer
+{
+public:
+    Buffer(uint8_t *ptr, size_t capacity) : _ptr(ptr), _capacity(capacity) {}
+
+    uint8_t *get()
+    {
+        return _ptr;
+    }
+
+    void setSize(size_t newSize)
+    {
+        _dataSize = newSize < _capacity ? newSize : _capacity;
+    }
+
+    size_t getSize() const
+    {
+        return _dataSize;
+    }
+
+    size_t getCapacity() const
+    {
+        return _capacity;
+    }
+
+    /**
+     * @brief      Marks buffer as a view of zeros standing for a hole of the input.
+     */
+    void setHole(bool hole)
+    {
+        _hole = hole;
+    }
+
+    bool isHole() const
+    {
+        return _hole;
+    }
+
+private:
+    uint8_t *_ptr;
+    size_t _dataSize = 0;
+    size_t _capacity;
+    bool _hole = false;
+};
+
+/**
+ * @brief      Bounded pool of page-aligned recycled buffers.
+ *
+ * Memory of a buffer is allocated on first demand and is never freed until the
+ * pool is destroyed, so a run does at most maxBuffers allocations.
+ */
+class BufferPool : public std::enable_shared_from_this<BufferPool>
+{
+public:
+    /**
+     * @brief      Creates the pool, use create() to get an instance.
+     *
+     * @param[in]  bufferSize  The capacity of one buffer in bytes.
+     * @param[in]  maxBuffers  The maximum number of buffers.
+     * @param[in]  hugePages   Try to back buffers with huge pages.
+     * @param[in]  node        NUMA node preferred for buffer memory, -1 for the usual placement.
+     */
+    BufferPool(size_t bufferSize, size_t maxBuffers, bool hugePages, int node = -1);
+    ~BufferPool();
+
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+
+    static std::shared_ptr<BufferPool> create(size_t bufferSize, size_t maxBuffers, bool hugePages = false,
+                                              int node = -1)
+    {
+        return std::make_shared<BufferPool>(bufferSize, maxBuffers, hugePages, node);
+    }
+
+    /**
+     * @brief      Takes a free buffer, blocks while all buffers are in use.
+     *
+     * @return     Buffer with zero size, it returns to the pool when released.
+     */
+    std::shared_ptr<Buffer> acquire();
+
+    size_t getBufferSize() const
+    {
+        return _bufferSize;
+    }
+
+    size_t getMaxBuffers() const
+    {
+        return _maxBuffers;
+    }
+
+    bool getHugePages() const
+    {
+        return _hugePages;
+    }
+
+private:
+    /**
+     * @brief      Memory mapping backing one buffer.
+     */
+    struct Chunk
+    {
+        void *ptr;
+        size_t length;
+    };
+
+    size_t _bufferSize;              // capacity of one buffer
+    size_t _maxBuffers;              // maximum number of allocated buffers
+    bool _hugePages;                 // buffers are backed with huge pages if possible
+    int _node;                       // preferred NUMA node, -1 if none
+    std::vector<Chunk> _chunks;      // all allocated memory
+    std::vector<Buffer *> _free;     // buffers ready to use
+    size_t _allocated = 0;           // number of allocated buffers
+    std::mutex _m;                   // mutex for access to _free and _allocated
+    std::condition_variable _freeCv; // wakes up waiting acquire()
+
+    uint8_t *allocate();
+    void release(Buffer *buffer);
+};
@@ -0,0 +1,138 @@
+#include "cdc_hasher.h"
+#include "file_handle.h"
+#include "md5_mb.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+static const size_t scanPartSize = 1024 * 1024; // the smallest part of window scanned by one thread
+
+/**
+ * @brief      Window of input with views of its chunks, released when the last chunk is hashed.
+ */
+struct ChunkWindow
+{
+    shared_ptr<Buffer> buffer;
+    vector<Buffer> chunks;
+};
+
+CdcHasher::CdcHasher(const Chunker &chunker, size_t threads, bool hugePages) :
+    MultiThreadHasher(chunker.maxSize(), threads, hugePages), // full chunk of zeros gets cached digest
+    _chunker(chunker),
+    _threads(max(static_cast<size_t>(1), threads))
+{
+    // window holds many chunks, the unfinished one is shorter than max size
+    size_t windowSize = max(static_cast<size_t>(16 * 1024 * 1024), 4 * chunker.maxSize());
+
+    // windows of all threads plus the one being read and the previous one holding the unfinished chunk
+    _buffers = BufferPool::create(windowSize, _threads + 2, hugePages);
+}
+
+shared_ptr<SignatureWriter> CdcHasher::openOutput(const string &, const string &outputFile)
+{
+    if (_verifier)
+    {
+        throw invalid_argument("chunk list cannot be verified");
+    }
+
+    _chunks = make_shared<ChunkWriter>(outputFile, _algorithm, _chunker.minSize(), _chunker.averageSize(),
+                                       _chunker.maxSize(), _flushInterval);
+    return _chunks;
+}
+
+void CdcHasher::readBlocks(const string &inputFile)
+{
+    FileHandle input(inputFile);
+    size_t lanes = md5MultiLanes();
+    shared_ptr<ChunkWindow> previous;
+    size_t carry = 0;    // bytes of unfinished chunk at the end of previous window
+    uint64_t offset = 0; // input offset of window start
+    bool last = false;
+
+    while (!last && !_exceptOccurred)
+    {
+        auto window = make_shared<ChunkWindow>();
+        window->buffer = acquireBuffer();
+        uint8_t *data = window->buffer->get();
+        size_t capacity = window->buffer->getCapacity();
+
+        if (carry > 0)
+        {
+            memcpy(data, previous->buffer->get() + previous->buffer->getSize() - carry, carry);
+        }
+
+        size_t count;
+
+        {
+            StageTimer timer(_stats.get(), Stage::Read);
+            count = input.read(data + carry, capacity - carry);
+        }
+
+        last = count < capacity - carry;
+        size_t end = carry + count;
+        window->buffer->setSize(end);
+        _inputSize += count;
+        previous.reset();
+
+        // parts are scanned in parallel, candidates of consecutive parts are the same as of the whole window
+        size_t parts = min(_threads, max(static_cast<size_t>(1), end / scanPartSize));
+        vector<vector<uint64_t>> found(parts);
+        vector<function<void()>> scans;
+
+        for (size_t part = 0; part < parts; ++part)
+        {
+            scans.push_back([this, data, end, parts, part, &found]()
+            {
+                _chunker.scan(data, end * part / parts, end * (part + 1) / parts, found[part]);
+            });
+        }
+
+        if (parts > 1)
+        {
+            runParallel(scans);
+        }
+        else
+        {
+            scans[0]();
+        }
+
+        vector<uint64_t> candidates = move(found[0]);
+
+        for (size_t part = 1; part < parts; ++part)
+        {
+            candidates.insert(candidates.end(), found[part].begin(), found[part].end());
+        }
+
+        vector<ChunkWriter::Chunk> chunks;
+        size_t start = 0, cursor = 0;
+
+        for (size_t cut; start < end && (cut = _chunker.cut(candidates, cursor, start, end, last)) != 0; start = cut)
+        {
+            chunks.push_back({offset + start, cut - start});
+            window->chunks.emplace_back(data + start, cut - start);
+            window->chunks.back().setSize(cut - start);
+        }
+
+        _chunks->addChunks(move(chunks)); // writer learns chunks before their digests come
+
+        for (size_t i = 0; i < window->chunks.size() && !_exceptOccurred; i += lanes)
+        {
+            vector<shared_ptr<Buffer>> batch;
+
+            for (size_t j = i; j < min(window->chunks.size(), i + lanes); ++j)
+            {
+                // aliasing pointer keeps the whole window while chunk is in use
+                batch.push_back(shared_ptr<Buffer>(window, &window->chunks[j]));
+            }
+
+            addHasherTask(move(batch));
+        }
+
+        carry = end - start;
+        offset += start;
+        previous = move(window);
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "block_hasher.h"
+#include "chunker.h"
+
+#include <memory>
+#include <string>
+
+/**
+ * @brief      Multi thread hasher of content-defined chunks.
+ *
+ * Input is read sequentially by large windows. Cut candidates of a window are
+ * found by all hasher threads scanning parts of it in parallel, then chunks are
+ * cut in order and hashed in place by batches filling lanes of MD5 kernel. The
+ * unfinished chunk at the window end is copied to the start of the next window.
+ * Output is a chunk list with offset and length of every chunk next to its digest.
+ */
+class CdcHasher : public MultiThreadHasher
+{
+public:
+    /**
+     * @brief      Constructs the chunk hasher.
+     *
+     * @param[in]  chunker    The chunk sizes.
+     * @param[in]  threads    The number of hasher threads.
+     * @param[in]  hugePages  Back window buffers with huge pages.
+     */
+    CdcHasher(const Chunker &chunker, size_t threads = 4, bool hugePages = false);
+protected:
+    virtual std::shared_ptr<SignatureWriter> openOutput(const std::string &inputFile,
+                                                        const std::string &outputFile) override;
+    virtual void readBlocks(const std::string &inputFile) override;
+
+    // chunk list has no trailer
+    virtual bool supportsFileDigest() const override
+    {
+        return false;
+    }
+private:
+    Chunker _chunker;
+    size_t _threads;
+    std::shared_ptr<ChunkWriter> _chunks; // output of the current Hash()
+};
@@ -0,0 +1,194 @@
+#include "checkpoint.h"
+#include "file_handle.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace std::chrono;
+
+static const char checkpointMagic[] = "blockHasher checkpoint 1";
+
+static const char *treeModeName(TreeMode tree)
+{
+    return tree == TreeMode::Levels ? "levels" : tree == TreeMode::Root ? "root" : "none";
+}
+
+InputIdentity InputIdentity::of(const string &inputFile)
+{
+    FileHandle input(inputFile);
+    struct stat st;
+
+    if (!input.isRegular() || fstat(input.get(), &st) != 0)
+    {
+        throw invalid_argument("stream input " + inputFile + " cannot be resumed");
+    }
+
+    InputIdentity identity;
+    identity.size = input.size(); // size of block device is not in stat
+    identity.mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    identity.inode = st.st_ino;
+    identity.device = st.st_dev;
+    return identity;
+}
+
+bool Checkpoint::load(const string &fileName)
+{
+    ifstream file(fileName);
+
+    if (!file)
+    {
+        return false;
+    }
+
+    // key value lines after the magic line, all keys but range are required
+    string line;
+    unsigned found = 0;
+
+    if (!getline(file, line) || line != checkpointMagic)
+    {
+        throw runtime_error("wrong checkpoint " + fileName);
+    }
+
+    while (getline(file, line))
+    {
+        istringstream values(line);
+        string key, value;
+        values >> key;
+
+        if (key == "input" && values >> input.size >> input.mtime >> input.inode >> input.device)
+        {
+            found |= 1;
+        }
+        else if (key == "algorithm" && values >> value)
+        {
+            algorithm = parseHashAlgorithm(value);
+            found |= 2;
+        }
+        else if (key == "block-size" && values >> blockSize)
+        {
+            found |= 4;
+        }
+        else if (key == "format" && values >> value)
+        {
+            format = parseSignatureFormat(value);
+            found |= 8;
+        }
+        else if (key == "tree" && values >> value)
+        {
+            tree = value == "levels" ? TreeMode::Levels : value == "root" ? TreeMode::Root : TreeMode::None;
+            found |= 16;
+        }
+        else if (key == "written" && values >> written.blockCount >> written.outputSize)
+        {
+            found |= 32;
+        }
+        else if (key == "range") // optional, older checkpoints are of the whole input
+        {
+            values >> rangeFirst >> rangeBlocks;
+        }
+    }
+
+    if (found != 63)
+    {
+        throw runtime_error("wrong checkpoint " + fileName);
+    }
+
+    return true;
+}
+
+void Checkpoint::store(const string &fileName) const
+{
+    ostringstream text;
+    text << checkpointMagic << "\n" <<
+         "input " << input.size << " " << input.mtime << " " << input.inode << " " << input.device << "\n" <<
+         "algorithm " << hashAlgorithmName(algorithm) << "\n" <<
+         "block-size " << blockSize << "\n" <<
+         "format " << (format == SignatureFormat::Binary ? "binary" : "text") << "\n" <<
+         "tree " << treeModeName(tree) << "\n" <<
+         "range " << rangeFirst << " " << rangeBlocks << "\n" <<
+         "written " << written.blockCount << " " << written.outputSize << "\n";
+
+    string data = text.str();
+    string temporary = fileName + ".tmp";
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool stored = fd >= 0 && ::write(fd, data.data(), data.size()) == static_cast<ssize_t>(data.size()) &&
+                  fsync(fd) == 0;
+
+    if (fd >= 0)
+    {
+        stored = close(fd) == 0 && stored;
+    }
+
+    // rename replaces the old checkpoint atomically, syncing the directory makes it durable
+    if (!stored || rename(temporary.c_str(), fileName.c_str()) != 0)
+    {
+        int error = errno;
+        unlink(temporary.c_str());
+        throw runtime_error("cannot write checkpoint " + fileName + ": " + strerror(error));
+    }
+
+    size_t slash = fileName.rfind('/');
+    string directory = slash == string::npos ? "." : slash == 0 ? "/" : fileName.substr(0, slash);
+    int dir = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (dir >= 0)
+    {
+        fsync(dir);
+        close(dir);
+    }
+}
+
+CheckpointWriter::CheckpointWriter(shared_ptr<SignatureWriter> output, const Checkpoint &checkpoint,
+                                   const string &fileName, double interval) :
+    _output(move(output)),
+    _checkpoint(checkpoint),
+    _fileName(fileName),
+    _interval(duration_cast<steady_clock::duration>(duration<double>(interval))),
+    _next(steady_clock::now() + _interval)
+{
+}
+
+void CheckpointWriter::write(const Digest &digest)
+{
+    _output->write(digest);
+    ++_checkpoint.written.blockCount;
+
+    if (steady_clock::now() >= _next)
+    {
+        sync();
+    }
+}
+
+uint64_t CheckpointWriter::sync()
+{
+    // digests become durable before checkpoint points to them
+    _checkpoint.written.outputSize = _output->sync();
+    _checkpoint.store(_fileName);
+    _next = steady_clock::now() + _interval;
+    return _checkpoint.written.outputSize;
+}
+
+void CheckpointWriter::setFileDigest(const Digest &digest)
+{
+    _output->setFileDigest(digest);
+}
+
+void CheckpointWriter::setShard(uint64_t firstBlock, uint64_t blockSize, uint64_t inputSize)
+{
+    _output->setShard(firstBlock, blockSize, inputSize);
+}
+
+void CheckpointWriter::finish(uint64_t inputSize)
+{
+    _output->finish(inputSize);
+    _output->sync(); // complete signature is durable before its checkpoint goes away
+    unlink(_fileName.c_str());
+}
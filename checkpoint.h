@@ -0,0 +1,127 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "hash_algorithm.h"
+#include "merkle_tree.h"
+#include "signature.h"
+
+/**
+ * @brief      Identity of input file, a resumed run must hash the same unchanged file.
+ */
+struct InputIdentity
+{
+    uint64_t size = 0;
+    int64_t mtime = 0; // modification time in nanoseconds
+    uint64_t inode = 0;
+    uint64_t device = 0;
+
+    /**
+     * @brief      Gets identity of input file.
+     *
+     * @param[in]  inputFile  The input file.
+     *
+     * @return     The identity.
+     *
+     * @throws     std::invalid_argument if input is a stream, it cannot be read again from an offset.
+     */
+    static InputIdentity of(const std::string &inputFile);
+
+    bool operator==(const InputIdentity &other) const
+    {
+        return size == other.size && mtime == other.mtime && inode == other.inode && device == other.device;
+    }
+};
+
+/**
+ * @brief      Progress of hashing durably recorded next to the signature.
+ *
+ * Checkpoint describes the run (input identity and signature settings) and
+ * the part of signature durably written so far. It is stored in a small text
+ * file replaced atomically, so a crash leaves either the old or the new one.
+ */
+struct Checkpoint
+{
+    InputIdentity input;
+    HashAlgorithm algorithm = HashAlgorithm::Md5;
+    uint64_t blockSize = 0;
+    SignatureFormat format = SignatureFormat::Text;
+    TreeMode tree = TreeMode::None;
+    uint64_t rangeFirst = 0;              // first block of shard
+    uint64_t rangeBlocks = UINT64_MAX;    // blocks of shard, UINT64_MAX up to the input end
+    ResumePoint written; // durable part of the signature
+
+    /**
+     * @brief      Gets checkpoint file of signature.
+     */
+    static std::string fileName(const std::string &outputFile)
+    {
+        return outputFile + ".checkpoint";
+    }
+
+    /**
+     * @brief      Checks that checkpoint describes the same run, progress is not compared.
+     */
+    bool sameRun(const Checkpoint &other) const
+    {
+        return input == other.input && algorithm == other.algorithm && blockSize == other.blockSize &&
+               format == other.format && tree == other.tree && rangeFirst == other.rangeFirst &&
+               rangeBlocks == other.rangeBlocks;
+    }
+
+    /**
+     * @brief      Reads checkpoint.
+     *
+     * @param[in]  fileName  The checkpoint file.
+     *
+     * @return     False if there is no checkpoint file.
+     *
+     * @throws     std::runtime_error if the file is malformed.
+     */
+    bool load(const std::string &fileName);
+
+    /**
+     * @brief      Replaces checkpoint file atomically and durably.
+     *
+     * @param[in]  fileName  The checkpoint file.
+     *
+     * @throws     std::runtime_error if the file cannot be written.
+     */
+    void store(const std::string &fileName) const;
+};
+
+/**
+ * @brief      Signature writer recording checkpoints of another writer.
+ *
+ * Every interval the signature is synced to disk and then its size and block
+ * count are stored to checkpoint, so checkpoint never points past durable
+ * digests. The checkpoint is removed when the signature is finished.
+ */
+class CheckpointWriter : public SignatureWriter
+{
+public:
+    /**
+     * @brief      Constructs the writer.
+     *
+     * @param[in]  output      The signature writer.
+     * @param[in]  checkpoint  The checkpoint of the run, written part is the part kept by the output.
+     * @param[in]  fileName    The checkpoint file.
+     * @param[in]  interval    Seconds between checkpoints.
+     */
+    CheckpointWriter(std::shared_ptr<SignatureWriter> output, const Checkpoint &checkpoint,
+                     const std::string &fileName, double interval);
+    virtual void write(const Digest &digest) override;
+    virtual void finish(uint64_t inputSize) override;
+    virtual uint64_t sync() override;
+    virtual void setFileDigest(const Digest &digest) override;
+    virtual void setShard(uint64_t firstBlock, uint64_t blockSize, uint64_t inputSize) override;
+private:
+    std::shared_ptr<SignatureWriter> _output;
+    Checkpoint _checkpoint;
+    std::string _fileName;
+    std::chrono::steady_clock::duration _interval;
+    std::chrono::steady_clock::time_point _next; // time of the next checkpoint
+};
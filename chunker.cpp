@@ -0,0 +1,213 @@
+#include "chunker.h"
+#include "chunker_kernel.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+using namespace std::chrono;
+
+typedef void (*GearScanFunc)(const uint8_t *, size_t, size_t, const uint64_t *, uint64_t, uint64_t,
+                             vector<uint64_t> &);
+
+#if defined(__x86_64__) || defined(__i386__)
+// implemented in translation units compiled with the matching target flags
+void gearScanAvx2(const uint8_t *data, size_t begin, size_t end, const uint64_t *gear,
+                  uint64_t weakMask, uint64_t strongMask, vector<uint64_t> &out);
+void gearScanAvx512(const uint8_t *data, size_t begin, size_t end, const uint64_t *gear,
+                    uint64_t weakMask, uint64_t strongMask, vector<uint64_t> &out);
+#endif
+
+/**
+ * @brief      Gear table of 256 pseudo-random values, fixed so chunks are the same on every host.
+ */
+struct GearTable
+{
+    uint64_t values[256];
+
+    GearTable()
+    {
+        uint64_t state = 0x676561727461626cULL; // splitmix64 sequence
+
+        for (auto &value : values)
+        {
+            uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            value = z ^ (z >> 31);
+        }
+    }
+};
+
+static const GearTable gearTable;
+
+/**
+ * @brief      Mask of the high bits of the hash, they depend on all 64 bytes of the window.
+ */
+static uint64_t highBits(size_t bits)
+{
+    return bits == 0 ? 0 : ~0ULL << (64 - bits);
+}
+
+/**
+ * @brief      Selected scan kernel description.
+ */
+struct GearKernel
+{
+    GearScanFunc func;
+    const char *name;
+};
+
+static GearKernel selectKernel()
+{
+    GearKernel kernels[] =
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        {gearScanAvx512, "avx512"},
+        {gearScanAvx2, "avx2"},
+#endif
+        {gearScanScalar, "scalar"},
+    };
+
+    auto supported = [](const GearKernel &kernel)
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_cpu_init();
+        string name(kernel.name);
+
+        if (name == "avx512")
+        {
+            return __builtin_cpu_supports("avx512f") != 0;
+        }
+        if (name == "avx2")
+        {
+            return __builtin_cpu_supports("avx2") != 0;
+        }
+#endif
+        return true;
+    };
+
+    const char *forced = getenv("BLOCKHASHER_CDC_KERNEL");
+
+    if (forced != nullptr)
+    {
+        for (const auto &kernel : kernels)
+        {
+            if (string(forced) == kernel.name && supported(kernel))
+            {
+                return kernel;
+            }
+        }
+    }
+
+    // gathers are not faster than scalar loads on every CPU, so the kernels are timed on sample data
+    vector<uint8_t> sample(1 << 20);
+    vector<uint64_t> candidates;
+    GearKernel best = {gearScanScalar, "scalar"};
+    auto bestTime = steady_clock::duration::max();
+
+    for (size_t i = 0; i < sample.size(); ++i)
+    {
+        sample[i] = static_cast<uint8_t>(gearTable.values[i & 0xff] >> (i >> 8 & 0x38));
+    }
+
+    for (const auto &kernel : kernels)
+    {
+        if (!supported(kernel))
+        {
+            continue;
+        }
+
+        auto time = steady_clock::duration::max();
+
+        for (int run = 0; run < 3; ++run)
+        {
+            candidates.clear();
+            auto start = steady_clock::now();
+            kernel.func(sample.data(), 0, sample.size(), gearTable.values, highBits(11), highBits(15), candidates);
+            time = min(time, steady_clock::now() - start);
+        }
+
+        if (time < bestTime)
+        {
+            best = kernel;
+            bestTime = time;
+        }
+    }
+
+    return best;
+}
+
+static const GearKernel &selectedKernel()
+{
+    static const GearKernel selected = selectKernel();
+    return selected;
+}
+
+Chunker::Chunker(size_t minSize, size_t averageSize, size_t maxSize) :
+    _minSize(minSize),
+    _averageSize(averageSize),
+    _maxSize(maxSize)
+{
+    if (minSize < window || averageSize < minSize || maxSize < averageSize)
+    {
+        throw invalid_argument("chunk sizes must be 64 <= min <= average <= max");
+    }
+
+    size_t bits = 0;
+
+    while ((static_cast<size_t>(2) << bits) <= averageSize)
+    {
+        ++bits;
+    }
+
+    // normalization level 2: chunk lengths concentrate around the average
+    _strongMask = highBits(bits + 2);
+    _weakMask = highBits(bits > 2 ? bits - 2 : 1);
+}
+
+void Chunker::scan(const uint8_t *data, size_t begin, size_t end, vector<uint64_t> &candidates) const
+{
+    if (begin < end)
+    {
+        selectedKernel().func(data, begin, end, gearTable.values, _weakMask, _strongMask, candidates);
+    }
+}
+
+size_t Chunker::cut(const vector<uint64_t> &candidates, size_t &cursor, size_t start, size_t end, bool last) const
+{
+    size_t first = start + _minSize; // the shortest allowed chunk end
+    size_t normal = start + _averageSize;
+    size_t limit = start + _maxSize;
+
+    while (cursor < candidates.size() && (candidates[cursor] >> 1) < first)
+    {
+        ++cursor;
+    }
+
+    // candidates are found in data, so the first matching one stands however much data follows
+    for (; cursor < candidates.size() && (candidates[cursor] >> 1) <= min(limit, end); ++cursor)
+    {
+        size_t candidate = candidates[cursor] >> 1;
+
+        if (candidate >= normal || (candidates[cursor] & 1))
+        {
+            ++cursor;
+            return candidate;
+        }
+    }
+
+    if (limit <= end)
+    {
+        return limit;
+    }
+
+    return last && end > start ? end : 0;
+}
+
+const char *Chunker::kernel()
+{
+    return selectedKernel().name;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief      Content-defined chunking with Gear rolling hash (FastCDC).
+ *
+ * Hash of a position is h = (h << 1) + gear[byte], so after 64 bytes it only
+ * depends on the last 64 bytes. Chunk is cut after a position whose hash has
+ * zero bits under the mask: the strong mask (more bits) while the chunk is
+ * shorter than the average size and the weak one after it (normalized
+ * chunking), chunk lengths are kept between min and max sizes. Masks take the
+ * high bits of the hash, which depend on all 64 bytes.
+ *
+ * Unlike the original FastCDC the hash is not reset at the chunk start: min
+ * size is at least 64 bytes, so the hash of every position that can end a chunk
+ * covers the full 64 bytes either way. Cut candidates therefore do not depend on
+ * where the chunk started, and any part of the data can be scanned on its own:
+ * scan() finds candidates in parallel over large windows, cut() then walks them
+ * from chunk to chunk. The scan can use AVX-512 or AVX2 gathers hashing 8 or 4
+ * parts of the range at once, the fastest kernel supported by the CPU is
+ * picked by timing them on sample data at first use. The kernel can be forced
+ * by BLOCKHASHER_CDC_KERNEL environment variable (scalar, avx2, avx512).
+ */
+class Chunker
+{
+public:
+    static const size_t window = 64; // bytes covered by the rolling hash
+
+    /**
+     * @brief      Constructs the chunker.
+     *
+     * @param[in]  minSize      The minimal chunk size, at least 64 bytes.
+     * @param[in]  averageSize  The average chunk size, rounded down to a power of two for masks.
+     * @param[in]  maxSize      The maximal chunk size.
+     *
+     * @throws     std::invalid_argument unless 64 <= minSize <= averageSize <= maxSize.
+     */
+    Chunker(size_t minSize, size_t averageSize, size_t maxSize);
+
+    size_t minSize() const
+    {
+        return _minSize;
+    }
+
+    size_t averageSize() const
+    {
+        return _averageSize;
+    }
+
+    size_t maxSize() const
+    {
+        return _maxSize;
+    }
+
+    /**
+     * @brief      Finds cut candidates in range of data.
+     *
+     * Hash of the range start is warmed up with up to 64 bytes before it, so
+     * results of consecutive ranges are the same as of their union.
+     *
+     * @param[in]  data        The data, bytes before begin must be readable.
+     * @param[in]  begin       The range begin.
+     * @param[in]  end         The range end.
+     * @param      candidates  Ascending chunk ends (offset after the position) appended as end << 1 | strong.
+     */
+    void scan(const uint8_t *data, size_t begin, size_t end, std::vector<uint64_t> &candidates) const;
+
+    /**
+     * @brief      Finds end of chunk starting at given offset.
+     *
+     * @param[in]  candidates  The candidates of data found by scan().
+     * @param      cursor      Index of the first candidate to check, advanced past the chunk end.
+     * @param[in]  start       The chunk start.
+     * @param[in]  end         The end of available data.
+     * @param[in]  last        No data follows end.
+     *
+     * @return     Chunk end, 0 if the chunk may continue past end and more data is needed.
+     */
+    size_t cut(const std::vector<uint64_t> &candidates, size_t &cursor, size_t start, size_t end, bool last) const;
+
+    /**
+     * @brief      Gets name of the selected scan kernel: "scalar", "avx2" or "avx512".
+     */
+    static const char *kernel();
+private:
+    size_t _minSize;
+    size_t _averageSize;
+    size_t _maxSize;
+    uint64_t _strongMask; // used while chunk is shorter than average size
+    uint64_t _weakMask;   // used after it, candidates of strong mask are a subset
+};
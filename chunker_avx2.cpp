@@ -0,0 +1,56 @@
+#include "chunker_kernel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+/**
+ * @brief      Four 64-bit hashes in AVX2 register, gear values are gathered.
+ */
+struct GearLanesAvx2
+{
+    static const size_t count = 4;
+    typedef __m256i Vec;
+
+    static Vec load(const uint64_t *values)
+    {
+        return _mm256_load_si256(reinterpret_cast<const __m256i *>(values));
+    }
+
+    static void store(uint64_t *values, Vec vec)
+    {
+        _mm256_store_si256(reinterpret_cast<__m256i *>(values), vec);
+    }
+
+    static Vec broadcast(uint64_t value)
+    {
+        return _mm256_set1_epi64x(static_cast<long long>(value));
+    }
+
+    static Vec words(const uint8_t *data, Vec offsets)
+    {
+        return _mm256_i64gather_epi64(reinterpret_cast<const long long *>(data), offsets, 1);
+    }
+
+    static Vec step(Vec hashes, Vec words, size_t k, const uint64_t *gear)
+    {
+        Vec bytes = _mm256_and_si256(_mm256_srl_epi64(words, _mm_cvtsi64_si128(static_cast<long long>(8 * k))),
+                                     _mm256_set1_epi64x(0xff));
+        Vec values = _mm256_i64gather_epi64(reinterpret_cast<const long long *>(gear), bytes, 8);
+        return _mm256_add_epi64(_mm256_add_epi64(hashes, hashes), values);
+    }
+
+    static unsigned matches(Vec hashes, Vec mask)
+    {
+        Vec zero = _mm256_cmpeq_epi64(_mm256_and_si256(hashes, mask), _mm256_setzero_si256());
+        return static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(zero)));
+    }
+};
+
+void gearScanAvx2(const uint8_t *data, size_t begin, size_t end, const uint64_t *gear,
+                  uint64_t weakMask, uint64_t strongMask, std::vector<uint64_t> &out)
+{
+    gearScanLanes<GearLanesAvx2>(data, begin, end, gear, weakMask, strongMask, out);
+}
+
+#endif
@@ -0,0 +1,58 @@
+#include "chunker_kernel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+/**
+ * @brief      Eight 64-bit hashes in AVX-512 register, gear values are gathered.
+ */
+struct GearLanesAvx512
+{
+    static const size_t count = 8;
+    typedef __m512i Vec;
+    typedef uint64_t Words __attribute__((vector_size(64)));
+
+    static Vec load(const uint64_t *values)
+    {
+        return _mm512_load_si512(values);
+    }
+
+    static void store(uint64_t *values, Vec vec)
+    {
+        _mm512_store_si512(values, vec);
+    }
+
+    static Vec broadcast(uint64_t value)
+    {
+        return _mm512_set1_epi64(static_cast<long long>(value));
+    }
+
+    static Vec words(const uint8_t *data, Vec offsets)
+    {
+        return _mm512_mask_i64gather_epi64(_mm512_setzero_si512(), 0xff, offsets,
+                                           reinterpret_cast<const long long *>(data), 1);
+    }
+
+    static Vec step(Vec hashes, Vec words, size_t k, const uint64_t *gear)
+    {
+        // shift of vector extension and masked gather with zero source avoid undefined registers
+        Vec bytes = reinterpret_cast<Vec>((reinterpret_cast<Words>(words) >> (8 * k)) & 0xff);
+        Vec values = _mm512_mask_i64gather_epi64(_mm512_setzero_si512(), 0xff, bytes,
+                                                 reinterpret_cast<const long long *>(gear), 8);
+        return _mm512_add_epi64(_mm512_add_epi64(hashes, hashes), values);
+    }
+
+    static unsigned matches(Vec hashes, Vec mask)
+    {
+        return _mm512_testn_epi64_mask(hashes, mask);
+    }
+};
+
+void gearScanAvx512(const uint8_t *data, size_t begin, size_t end, const uint64_t *gear,
+                    uint64_t weakMask, uint64_t strongMask, std::vector<uint64_t> &out)
+{
+    gearScanLanes<GearLanesAvx512>(data, begin, end, gear, weakMask, strongMask, out);
+}
+
+#endif
@@ -0,0 +1,168 @@
+#pragma once
+
+/*
+ * Gear hash scan shared by the scalar, AVX2 and AVX-512 kernels of Chunker.
+ *
+ * Included by translation units compiled with their own target flags, so
+ * everything here has internal linkage.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+
+/**
+ * @brief      Gets hash before position from up to 64 previous bytes.
+ */
+inline uint64_t gearWarmUp(const uint8_t *data, size_t position, const uint64_t *gear)
+{
+    uint64_t hash = 0;
+
+    for (size_t i = position - std::min<size_t>(position, 64); i < position; ++i)
+    {
+        hash = (hash << 1) + gear[data[i]];
+    }
+
+    return hash;
+}
+
+/**
+ * @brief      Appends candidate ending after position if the hash matches the weak mask.
+ */
+inline void gearRecord(uint64_t hash, size_t position, uint64_t weakMask, uint64_t strongMask,
+                       std::vector<uint64_t> &out)
+{
+    if ((hash & weakMask) == 0)
+    {
+        out.push_back(static_cast<uint64_t>(position + 1) << 1 | ((hash & strongMask) == 0));
+    }
+}
+
+/**
+ * @brief      Scans range with scalar code, 8 bytes are loaded at once.
+ */
+inline void gearScanScalar(const uint8_t *data, size_t begin, size_t end, const uint64_t *gear,
+                           uint64_t weakMask, uint64_t strongMask, std::vector<uint64_t> &out)
+{
+    uint64_t hash = gearWarmUp(data, begin, gear);
+    size_t i = begin;
+
+    for (; i + 8 <= end; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+
+        for (size_t k = 0; k < 8; ++k)
+        {
+            hash = (hash << 1) + gear[(word >> (8 * k)) & 0xff];
+
+            if (__builtin_expect((hash & weakMask) == 0, 0))
+            {
+                gearRecord(hash, i + k, weakMask, strongMask, out);
+            }
+        }
+    }
+
+    for (; i < end; ++i)
+    {
+        hash = (hash << 1) + gear[data[i]];
+        gearRecord(hash, i, weakMask, strongMask, out);
+    }
+}
+
+/**
+ * @brief      Scans range split in parts hashed in vector lanes.
+ *
+ * Lanes describes the vector: count of lanes, type Vec, load() and store()
+ * of 64-bit lanes, broadcast(), words(data, offsets) loading 8 bytes at every
+ * offset from data, step(hashes, words, k, gear) shifting hashes and adding
+ * gear values of byte k of the words, and matches(hashes, mask) returning bit
+ * mask of lanes with zero bits under the mask.
+ *
+ * Parts are warmed up separately. Matches are collected without calls by
+ * blocks, so hashes stay in registers, and are recorded per part after every
+ * block. Candidates of parts are appended in order, the rest of the range
+ * after whole parts is scanned with scalar code.
+ */
+template <typename Lanes>
+inline void gearScanLanes(const uint8_t *data, size_t begin, size_t end, const uint64_t *gear,
+                          uint64_t weakMask, uint64_t strongMask, std::vector<uint64_t> &out)
+{
+    const size_t n = Lanes::count;
+    const size_t block = 4096; // bytes of every part hashed between recording matches
+    size_t part = (end - begin) / n / 8 * 8;
+
+    if (part < 64) // warming up would cost more than it saves
+    {
+        gearScanScalar(data, begin, end, gear, weakMask, strongMask, out);
+        return;
+    }
+
+    alignas(64) uint64_t hashes[n];
+    alignas(64) uint64_t offsets[n];
+    std::vector<uint64_t> found[n];
+    std::vector<uint64_t> matchHashes(block * n);
+    std::vector<uint32_t> matchPlaces(block * n); // lane << 16 | offset in block
+
+    for (size_t lane = 0; lane < n; ++lane)
+    {
+        hashes[lane] = gearWarmUp(data, begin + lane * part, gear);
+        offsets[lane] = lane * part;
+    }
+
+    typename Lanes::Vec hash = Lanes::load(hashes);
+    typename Lanes::Vec mask = Lanes::broadcast(weakMask);
+    typename Lanes::Vec laneOffsets = Lanes::load(offsets);
+
+    for (size_t first = 0; first < part; first += block)
+    {
+        size_t last = std::min(part, first + block);
+        size_t count = 0;
+
+        for (size_t i = first; i < last; i += 8)
+        {
+            typename Lanes::Vec word = Lanes::words(data + begin + i, laneOffsets);
+
+            for (size_t k = 0; k < 8; ++k)
+            {
+                hash = Lanes::step(hash, word, k, gear);
+                unsigned matches = Lanes::matches(hash, mask);
+
+                if (__builtin_expect(matches != 0, 0))
+                {
+                    Lanes::store(hashes, hash);
+
+                    for (size_t lane = 0; lane < n; ++lane)
+                    {
+                        if (matches & (1u << lane))
+                        {
+                            matchHashes[count] = hashes[lane];
+                            matchPlaces[count++] = static_cast<uint32_t>(lane << 16 | (i - first + k));
+                        }
+                    }
+                }
+            }
+        }
+
+        for (size_t match = 0; match < count; ++match)
+        {
+            size_t lane = matchPlaces[match] >> 16;
+            gearRecord(matchHashes[match], begin + lane * part + first + (matchPlaces[match] & 0xffff),
+                       weakMask, strongMask, found[lane]);
+        }
+    }
+
+    for (size_t lane = 0; lane < n; ++lane)
+    {
+        out.insert(out.end(), found[lane].begin(), found[lane].end());
+    }
+
+    gearScanScalar(data, begin + n * part, end, gear, weakMask, strongMask, out);
+}
+
+} // namespace
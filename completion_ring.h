@@ -0,0 +1,246 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <thread>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+ * @brief      Lock-free reorder ring of task results indexed by sequence number.
+ *
+ * One producer reserves sequence numbers in order, any thread publishes the
+ * result of its sequence number into the slot, and one consumer drains completed
+ * slots in order. Threads sleep on futexes only when there is nothing to do,
+ * and a sleeping side is woken only by the event it waits for.
+ *
+ * @tparam     T     Result type.
+ */
+template <typename T>
+class CompletionRing
+{
+public:
+    /**
+     * @brief      Constructs the ring.
+     *
+     * @param[in]  capacity  Maximum number of reserved but not drained results.
+     */
+    CompletionRing(size_t capacity) :
+        _capacity(capacity > 0 ? capacity : 1),
+        _slots(new Slot[_capacity])
+    {
+    }
+
+    CompletionRing(const CompletionRing &) = delete;
+    CompletionRing &operator=(const CompletionRing &) = delete;
+
+    /**
+     * @brief      Reserves the next sequence number, waits while the ring is full.
+     *
+     * Must be called by the single producer thread.
+     *
+     * @param      seq   The reserved sequence number.
+     *
+     * @return     False if the ring was aborted.
+     */
+    bool reserve(uint64_t &seq)
+    {
+        uint64_t tail = _tail.load(std::memory_order_relaxed);
+
+        while (tail - _head.load(std::memory_order_acquire) >= _capacity)
+        {
+            if (_aborted.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+
+            waitFor(_readerEvent, _readerWaiting, [&]()
+            {
+                return tail - _head.load(std::memory_order_acquire) < _capacity ||
+                       _aborted.load(std::memory_order_acquire);
+            });
+        }
+
+        seq = tail;
+        _tail.store(tail + 1, std::memory_order_release);
+        return !_aborted.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief      Publishes result of reserved sequence number.
+     *
+     * @param[in]  seq    The sequence number.
+     * @param[in]  value  The result.
+     */
+    void publish(uint64_t seq, T value)
+    {
+        Slot &slot = _slots[seq % _capacity];
+        slot.value = std::move(value);
+        complete(seq, slot, Ready);
+    }
+
+    /**
+     * @brief      Publishes failure of reserved sequence number.
+     *
+     * @param[in]  seq        The sequence number.
+     * @param[in]  exception  The exception, rethrown to consumer by next().
+     */
+    void fail(uint64_t seq, std::exception_ptr exception)
+    {
+        Slot &slot = _slots[seq % _capacity];
+        slot.exception = exception;
+        complete(seq, slot, Failed);
+    }
+
+    /**
+     * @brief      Takes the next result in sequence order, waits until it is published.
+     *
+     * Must be called by the single consumer thread.
+     *
+     * @param      value  The result.
+     *
+     * @return     False if all results are drained after close() or the ring was aborted.
+     */
+    bool next(T &value)
+    {
+        uint64_t head = _head.load(std::memory_order_relaxed);
+        Slot &slot = _slots[head % _capacity];
+
+        auto ready = [&]()
+        {
+            return slot.state.load(std::memory_order_acquire) != Empty ||
+                   _aborted.load(std::memory_order_acquire) ||
+                   (_closed.load(std::memory_order_acquire) && head == _tail.load(std::memory_order_acquire));
+        };
+
+        while (!ready())
+        {
+            waitFor(_writerEvent, _writerWaiting, ready);
+        }
+
+        if (_aborted.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        uint32_t state = slot.state.load(std::memory_order_acquire);
+
+        if (state == Empty) // closed and drained
+        {
+            return false;
+        }
+
+        if (state == Failed)
+        {
+            std::rethrow_exception(slot.exception);
+        }
+
+        value = std::move(slot.value);
+        slot.value = T();
+        slot.state.store(Empty, std::memory_order_relaxed);
+        _head.store(head + 1, std::memory_order_seq_cst);
+
+        if (_readerWaiting.load(std::memory_order_seq_cst))
+        {
+            wake(_readerEvent);
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief      Tells consumer that no more sequence numbers will be reserved.
+     */
+    void close()
+    {
+        _closed.store(true, std::memory_order_seq_cst);
+        wake(_writerEvent);
+    }
+
+    /**
+     * @brief      Stops both producer and consumer, used on errors.
+     */
+    void abort()
+    {
+        _aborted.store(true, std::memory_order_seq_cst);
+        wake(_writerEvent);
+        wake(_readerEvent);
+    }
+
+private:
+    enum : uint32_t
+    {
+        Empty,
+        Ready,
+        Failed
+    };
+
+    /**
+     * @brief      Result slot, aligned to avoid false sharing between workers.
+     */
+    struct alignas(64) Slot
+    {
+        std::atomic<uint32_t> state{Empty};
+        T value;
+        std::exception_ptr exception;
+    };
+
+    size_t _capacity;
+    std::unique_ptr<Slot[]> _slots;
+    alignas(64) std::atomic<uint64_t> _head{0};        // next sequence number to drain
+    alignas(64) std::atomic<uint64_t> _tail{0};        // next sequence number to reserve
+    alignas(64) std::atomic<uint32_t> _writerEvent{0}; // futex word of consumer
+    std::atomic<uint32_t> _writerWaiting{0};
+    alignas(64) std::atomic<uint32_t> _readerEvent{0}; // futex word of producer
+    std::atomic<uint32_t> _readerWaiting{0};
+    std::atomic_bool _closed{false};
+    std::atomic_bool _aborted{false};
+
+    void complete(uint64_t seq, Slot &slot, uint32_t state)
+    {
+        slot.state.store(state, std::memory_order_seq_cst);
+
+        // only the result consumer is waiting for needs a wake-up
+        if (_writerWaiting.load(std::memory_order_seq_cst) &&
+                _head.load(std::memory_order_seq_cst) == seq)
+        {
+            wake(_writerEvent);
+        }
+    }
+
+    static void wake(std::atomic<uint32_t> &event)
+    {
+        event.fetch_add(1, std::memory_order_seq_cst);
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(&event), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+    }
+
+    /**
+     * @brief      Spins shortly and then sleeps on event until condition is met or event changes.
+     */
+    template <typename Condition>
+    static void waitFor(std::atomic<uint32_t> &event, std::atomic<uint32_t> &waiting, Condition condition)
+    {
+        for (int i = 0; i < 64; ++i)
+        {
+            if (condition())
+            {
+                return;
+            }
+
+            std::this_thread::yield();
+        }
+
+        uint32_t current = event.load(std::memory_order_seq_cst);
+        waiting.store(1, std::memory_order_seq_cst);
+
+        if (!condition()) // recheck after announcing, publisher sees the flag otherwise
+        {
+            syscall(SYS_futex, reinterpret_cast<uint32_t *>(&event), FUTEX_WAIT_PRIVATE, current, nullptr, nullptr, 0);
+        }
+
+        waiting.store(0, std::memory_order_seq_cst);
+    }
+};
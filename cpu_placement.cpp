@@ -0,0 +1,201 @@
+#include "cpu_placement.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <dirent.h>
+#include <fstream>
+#include <sched.h>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+// placement of the calling thread, workers are pinned once per placement
+static thread_local const CpuPlacement *threadPlacement = nullptr;
+static thread_local size_t threadNode = 0;
+
+vector<int> parseCpuList(const string &list)
+{
+    vector<int> cpus;
+    stringstream stream(list);
+    string range;
+
+    while (getline(stream, range, ','))
+    {
+        size_t dash = range.find('-');
+        size_t end;
+        int first = stoi(range.substr(0, dash), &end);
+        int last = first;
+
+        if (end != (dash == string::npos ? range.size() : dash))
+        {
+            throw invalid_argument("wrong CPU list " + list);
+        }
+
+        if (dash != string::npos)
+        {
+            last = stoi(range.substr(dash + 1), &end);
+
+            if (end != range.size() - dash - 1)
+            {
+                throw invalid_argument("wrong CPU list " + list);
+            }
+        }
+
+        if (first < 0 || last < first || last >= CPU_SETSIZE)
+        {
+            throw invalid_argument("wrong CPU list " + list);
+        }
+
+        for (int cpu = first; cpu <= last; ++cpu)
+        {
+            cpus.push_back(cpu);
+        }
+    }
+
+    if (cpus.empty())
+    {
+        throw invalid_argument("empty CPU list");
+    }
+
+    sort(cpus.begin(), cpus.end());
+    cpus.erase(unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+/**
+ * @brief      Converts CPU numbers to affinity mask.
+ */
+static cpu_set_t cpuSet(const vector<int> &cpus)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    for (int cpu : cpus)
+    {
+        CPU_SET(cpu, &set);
+    }
+
+    return set;
+}
+
+void restrictProcessCpus(const vector<int> &cpus)
+{
+    cpu_set_t set = cpuSet(cpus);
+
+    if (sched_setaffinity(0, sizeof(set), &set) != 0)
+    {
+        throw system_error(errno, generic_category(), "cannot restrict process to given CPUs");
+    }
+}
+
+bool preferNumaNode(void *ptr, size_t length, int node)
+{
+    vector<unsigned long> mask(node / (8 * sizeof(unsigned long)) + 1);
+    mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+
+    // preferred policy falls back to other nodes instead of failing when the node is full
+    return syscall(SYS_mbind, ptr, length, MPOL_PREFERRED, mask.data(), mask.size() * 8 * sizeof(unsigned long) + 1,
+                   0) == 0;
+}
+
+CpuPlacement::CpuPlacement(bool spreadWorkers) :
+    _spreadWorkers(spreadWorkers)
+{
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    {
+        throw system_error(errno, generic_category(), "cannot get CPU affinity");
+    }
+
+    DIR *dir = opendir("/sys/devices/system/node");
+
+    for (dirent *entry = dir != nullptr ? readdir(dir) : nullptr; entry != nullptr; entry = readdir(dir))
+    {
+        string name = entry->d_name;
+
+        if (name.compare(0, 4, "node") != 0 || name.size() == 4 ||
+                name.find_first_not_of("0123456789", 4) != string::npos)
+        {
+            continue;
+        }
+
+        ifstream file("/sys/devices/system/node/" + name + "/cpulist");
+        string list;
+        Node node{stoi(name.substr(4)), {}};
+
+        if (!getline(file, list) || list.empty()) // memory-only node
+        {
+            continue;
+        }
+
+        for (int cpu : parseCpuList(list))
+        {
+            if (CPU_ISSET(cpu, &allowed))
+            {
+                node.cpus.push_back(cpu);
+            }
+        }
+
+        if (!node.cpus.empty())
+        {
+            _nodes.push_back(move(node));
+        }
+    }
+
+    if (dir != nullptr)
+    {
+        closedir(dir);
+    }
+
+    sort(_nodes.begin(), _nodes.end(), [](const Node &a, const Node &b) { return a.id < b.id; });
+
+    if (_nodes.empty()) // no NUMA support in kernel, all CPUs form one node
+    {
+        Node node{0, {}};
+
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &allowed))
+            {
+                node.cpus.push_back(cpu);
+            }
+        }
+
+        _nodes.push_back(move(node));
+    }
+}
+
+void CpuPlacement::pin(size_t node) const
+{
+    cpu_set_t set = cpuSet(_nodes[node].cpus);
+    sched_setaffinity(0, sizeof(set), &set); // placement is an optimization, failure is not an error
+    threadPlacement = this;
+    threadNode = node;
+}
+
+void CpuPlacement::pinHome() const
+{
+    pin(0);
+}
+
+void CpuPlacement::pinWorker()
+{
+    if (threadPlacement == this)
+    {
+        return;
+    }
+
+    pin(_spreadWorkers ? _nextWorker.fetch_add(1, memory_order_relaxed) % _nodes.size() : 0);
+}
+
+size_t CpuPlacement::currentNode() const
+{
+    return threadPlacement == this ? threadNode : 0;
+}
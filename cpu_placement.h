@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief      Parses CPU list like "0-3,8,10-11" as used by sysfs and taskset.
+ *
+ * @param[in]  list  The list.
+ *
+ * @return     Sorted unique CPU numbers.
+ *
+ * @throws     std::invalid_argument for malformed or empty list.
+ */
+std::vector<int> parseCpuList(const std::string &list);
+
+/**
+ * @brief      Restricts calling thread and all threads it starts later to given CPUs.
+ *
+ * Called at start of the program, it restricts the whole run.
+ *
+ * @param[in]  cpus  The CPUs.
+ *
+ * @throws     std::system_error if no given CPU is available.
+ */
+void restrictProcessCpus(const std::vector<int> &cpus);
+
+/**
+ * @brief      Prefers memory of NUMA node for pages of range faulted in later.
+ *
+ * @param      ptr     The page-aligned range start.
+ * @param[in]  length  The range length.
+ * @param[in]  node    The node.
+ *
+ * @return     False if the kernel has no NUMA support, memory is then placed as usual.
+ */
+bool preferNumaNode(void *ptr, size_t length, int node);
+
+/**
+ * @brief      Placement of pipeline threads on NUMA nodes.
+ *
+ * Nodes are read from sysfs and limited to CPUs the process may run on. The
+ * reader and the writer run on the home node (the first one). Hash workers
+ * run on the home node too when the reader fills their buffers, and are
+ * spread over all nodes round-robin when every worker reads its own blocks,
+ * so a block is read into and hashed from memory of the same node. Threads
+ * are bound to all CPUs of their node, the scheduler balances inside it.
+ */
+class CpuPlacement
+{
+public:
+    /**
+     * @brief      Detects NUMA nodes of available CPUs.
+     *
+     * @param[in]  spreadWorkers  Spread hash workers over all nodes.
+     */
+    CpuPlacement(bool spreadWorkers);
+
+    CpuPlacement(const CpuPlacement &) = delete;
+    CpuPlacement &operator=(const CpuPlacement &) = delete;
+
+    size_t nodeCount() const
+    {
+        return _nodes.size();
+    }
+
+    /**
+     * @brief      Gets NUMA node id of node index.
+     */
+    int nodeId(size_t index) const
+    {
+        return _nodes[index].id;
+    }
+
+    /**
+     * @brief      Binds calling thread to the home node, used by reader and writer.
+     */
+    void pinHome() const;
+
+    /**
+     * @brief      Binds calling hash worker to its node, only the first call of a thread has effect.
+     */
+    void pinWorker();
+
+    /**
+     * @brief      Gets node index of calling thread pinned by this placement, 0 otherwise.
+     */
+    size_t currentNode() const;
+private:
+    /**
+     * @brief      NUMA node with available CPUs.
+     */
+    struct Node
+    {
+        int id;
+        std::vector<int> cpus;
+    };
+
+    std::vector<Node> _nodes;
+    bool _spreadWorkers;
+    std::atomic<size_t> _nextWorker{0}; // round-robin counter of spread workers
+
+    void pin(size_t node) const;
+};
@@ -0,0 +1,84 @@
+#include "crc32c.h"
+
+typedef uint32_t (*Crc32cFunc)(uint32_t, const uint8_t *, size_t);
+
+#if defined(__x86_64__) || defined(__i386__)
+// implemented in translation unit compiled with -msse4.2
+uint32_t crc32cSse42(uint32_t crc, const uint8_t *data, size_t len);
+#endif
+
+/**
+ * @brief      Lookup tables for slicing by 8 bytes, reflected polynomial 0x82F63B78.
+ */
+struct Crc32cTable
+{
+    uint32_t table[8][256];
+
+    Crc32cTable()
+    {
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t crc = i;
+
+            for (int bit = 0; bit < 8; ++bit)
+            {
+                crc = (crc >> 1) ^ (0x82F63B78 & (0 - (crc & 1)));
+            }
+
+            table[0][i] = crc;
+        }
+
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            for (int slice = 1; slice < 8; ++slice)
+            {
+                table[slice][i] = (table[slice - 1][i] >> 8) ^ table[0][table[slice - 1][i] & 0xff];
+            }
+        }
+    }
+};
+
+static uint32_t crc32cTable(uint32_t crc, const uint8_t *data, size_t len)
+{
+    static const Crc32cTable tables;
+    const auto &t = tables.table;
+
+    for (; len >= 8; len -= 8, data += 8)
+    {
+        uint32_t low = crc ^ (static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8 |
+                              static_cast<uint32_t>(data[2]) << 16 | static_cast<uint32_t>(data[3]) << 24);
+        crc = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^ t[5][(low >> 16) & 0xff] ^ t[4][low >> 24] ^
+              t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+    }
+
+    for (; len > 0; --len, ++data)
+    {
+        crc = (crc >> 8) ^ t[0][(crc ^ *data) & 0xff];
+    }
+
+    return crc;
+}
+
+static Crc32cFunc selectCrc32c()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("sse4.2"))
+    {
+        return crc32cSse42;
+    }
+#endif
+    return crc32cTable;
+}
+
+uint32_t crc32c(const void *data, size_t len)
+{
+    return crc32cExtend(0, data, len);
+}
+
+uint32_t crc32cExtend(uint32_t crc, const void *data, size_t len)
+{
+    static const Crc32cFunc func = selectCrc32c();
+    return ~func(~crc, static_cast<const uint8_t *>(data), len);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief      Calculates CRC32C (Castagnoli) checksum.
+ *
+ * SSE4.2 crc32 instruction is used when supported by the CPU, lookup table otherwise.
+ *
+ * @param[in]  data  The data.
+ * @param[in]  len   The data length in bytes.
+ *
+ * @return     The checksum.
+ */
+uint32_t crc32c(const void *data, size_t len);
+
+/**
+ * @brief      Extends CRC32C checksum with data following the checksummed data.
+ *
+ * crc32cExtend(crc32c(a), b) is crc32c of a followed by b, crc32c(data) is crc32cExtend(0, data).
+ *
+ * @param[in]  crc   The checksum of preceding data, 0 for none.
+ * @param[in]  data  The data.
+ * @param[in]  len   The data length in bytes.
+ *
+ * @return     The checksum.
+ */
+uint32_t crc32cExtend(uint32_t crc, const void *data, size_t len);
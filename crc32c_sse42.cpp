@@ -0,0 +1,38 @@
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <nmmintrin.h>
+
+uint32_t crc32cSse42(uint32_t crc, const uint8_t *data, size_t len)
+{
+#if defined(__x86_64__)
+    uint64_t crc64 = crc;
+
+    for (; len >= 8; len -= 8, data += 8)
+    {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+
+    crc = static_cast<uint32_t>(crc64);
+#endif
+
+    for (; len >= 4; len -= 4, data += 4)
+    {
+        uint32_t word;
+        memcpy(&word, data, sizeof(word));
+        crc = _mm_crc32_u32(crc, word);
+    }
+
+    for (; len > 0; --len, ++data)
+    {
+        crc = _mm_crc32_u8(crc, *data);
+    }
+
+    return crc;
+}
+
+#endif
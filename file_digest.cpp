@@ -0,0 +1,127 @@
+#include "file_digest.h"
+#include "file_handle.h"
+
+#include <algorithm>
+#include <utility>
+
+using namespace std;
+
+static const size_t prefixReadSize = 4 * 1024 * 1024;
+
+FileDigest::FileDigest(const string &inputFile, uint64_t prefix) :
+    _inputFile(inputFile),
+    _prefix(prefix),
+    _thread(&FileDigest::run, this)
+{
+}
+
+FileDigest::~FileDigest()
+{
+    {
+        lock_guard<mutex> lock(_m);
+        _stopped = true;
+    }
+
+    _cv.notify_all();
+
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+}
+
+void FileDigest::add(vector<shared_ptr<Buffer>> batch)
+{
+    unique_lock<mutex> lock(_m);
+    _cv.wait(lock, [this]() { return _queue.size() < queueDepth || _error; });
+
+    if (_error)
+    {
+        rethrow_exception(_error);
+    }
+
+    _queue.push_back(move(batch));
+    lock.unlock();
+    _cv.notify_all();
+}
+
+Digest FileDigest::finish()
+{
+    {
+        lock_guard<mutex> lock(_m);
+        _closed = true;
+    }
+
+    _cv.notify_all();
+    _thread.join();
+
+    if (_error)
+    {
+        rethrow_exception(_error);
+    }
+
+    Digest digest(16);
+    _md5.finish(digest.data());
+    return digest;
+}
+
+void FileDigest::run()
+{
+    try
+    {
+        if (_prefix > 0)
+        {
+            FileHandle input(_inputFile);
+            _prefix = min<uint64_t>(_prefix, input.size()); // resumed after the last block
+            vector<uint8_t> data(static_cast<size_t>(min<uint64_t>(_prefix, prefixReadSize)));
+
+            for (uint64_t offset = 0; offset < _prefix; offset += data.size())
+            {
+                size_t length = static_cast<size_t>(min<uint64_t>(data.size(), _prefix - offset));
+                input.readAt(data.data(), length, offset);
+                _md5.update(data.data(), length);
+
+                lock_guard<mutex> lock(_m);
+
+                if (_stopped)
+                {
+                    return;
+                }
+            }
+        }
+
+        while (true)
+        {
+            vector<shared_ptr<Buffer>> batch;
+
+            {
+                unique_lock<mutex> lock(_m);
+                _cv.wait(lock, [this]() { return !_queue.empty() || _closed || _stopped; });
+
+                if (_stopped || _queue.empty())
+                {
+                    return;
+                }
+
+                batch = move(_queue.front());
+                _queue.pop_front();
+            }
+
+            _cv.notify_all(); // reader may wait for a free place
+
+            for (const auto &block : batch)
+            {
+                _md5.update(block->get(), block->getSize());
+            }
+        }
+    }
+    catch (...)
+    {
+        {
+            lock_guard<mutex> lock(_m);
+            _error = current_exception();
+        }
+
+        _cv.notify_all();
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "buffer_pool.h"
+#include "hash_algorithm.h"
+#include "md5.h"
+
+/**
+ * @brief      Whole-file MD5 computed by its own thread in the same pass as block digests.
+ *
+ * The reader hands batches of blocks over in file order. The thread feeds them
+ * to incremental MD5 and drops them, so a buffer returns to the pool when both
+ * block hasher and file digest are done with it. Hash workers never wait for
+ * the file digest, the reader waits only when it lags by queueDepth batches.
+ */
+class FileDigest
+{
+public:
+    static const size_t queueDepth = 2; // batches waiting for the thread
+
+    /**
+     * @brief      Starts the thread.
+     *
+     * @param[in]  inputFile  The input file.
+     * @param[in]  prefix     Bytes at the input start read by the thread before queued blocks,
+     *                        hashing resumed after them does not read them again.
+     */
+    FileDigest(const std::string &inputFile, uint64_t prefix);
+
+    /**
+     * @brief      Stops the thread, queued blocks are dropped.
+     */
+    ~FileDigest();
+
+    FileDigest(const FileDigest &) = delete;
+    FileDigest &operator=(const FileDigest &) = delete;
+
+    /**
+     * @brief      Queues the next blocks of input, waits while the queue is full.
+     *
+     * @param[in]  batch  The blocks following the previous ones.
+     *
+     * @throws     Exception of the thread if it failed.
+     */
+    void add(std::vector<std::shared_ptr<Buffer>> batch);
+
+    /**
+     * @brief      Waits until all queued blocks are hashed.
+     *
+     * @return     MD5 digest of the input.
+     *
+     * @throws     Exception of the thread if it failed.
+     */
+    Digest finish();
+private:
+    std::string _inputFile;
+    uint64_t _prefix;
+    Md5Stream _md5;
+    std::mutex _m; // protects fields below shared with the thread
+    std::condition_variable _cv; // wakes up both sides
+    std::deque<std::vector<std::shared_ptr<Buffer>>> _queue; // batches not hashed yet
+    bool _closed = false;  // no more batches will come
+    bool _stopped = false; // thread must exit now
+    std::exception_ptr _error;
+    std::thread _thread;
+
+    /**
+     * @brief      Thread function hashing the prefix and then queued batches.
+     */
+    void run();
+};
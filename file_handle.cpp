@@ -0,0 +1,148 @@
+#include "file_handle.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const size_t pipeBufferSize = 1024 * 1024;
+
+FileHandle::FileHandle(const string &fileName) : _name(fileName)
+{
+    if (fileName == "-")
+    {
+        _name = "standard input";
+        _fd = fcntl(STDIN_FILENO, F_DUPFD_CLOEXEC, 0); // own descriptor is closed as usual
+    }
+    else
+    {
+        _fd = open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+    }
+
+    if (_fd < 0)
+    {
+        throw invalid_argument("cannot open file " + fileName);
+    }
+
+    struct stat st;
+
+    if (fstat(_fd, &st) == 0)
+    {
+        _regular = S_ISREG(st.st_mode) || S_ISBLK(st.st_mode);
+
+        if (_regular)
+        {
+            off_t position = lseek(_fd, 0, SEEK_CUR); // redirected standard input may be positioned
+            _position = position > 0 ? position : 0;
+        }
+
+#ifdef F_SETPIPE_SZ
+        if (S_ISFIFO(st.st_mode))
+        {
+            fcntl(_fd, F_SETPIPE_SZ, pipeBufferSize); // best effort, limited by fs.pipe-max-size
+        }
+#endif
+    }
+}
+
+bool FileHandle::isStream(const string &fileName)
+{
+    struct stat st;
+
+    if (fileName == "-")
+    {
+        // positional engines read from the start, so positioned standard input is read sequentially
+        return fstat(STDIN_FILENO, &st) != 0 || !(S_ISREG(st.st_mode) || S_ISBLK(st.st_mode)) ||
+               lseek(STDIN_FILENO, 0, SEEK_CUR) > 0;
+    }
+
+    return stat(fileName.c_str(), &st) == 0 && (S_ISFIFO(st.st_mode) || S_ISSOCK(st.st_mode) || S_ISCHR(st.st_mode));
+}
+
+FileHandle::~FileHandle()
+{
+    close(_fd);
+}
+
+size_t FileHandle::size() const
+{
+    struct stat st;
+
+    if (fstat(_fd, &st) != 0)
+    {
+        throw runtime_error("cannot stat file " + _name + ": " + strerror(errno));
+    }
+
+    uint64_t bytes = 0;
+
+    if (S_ISBLK(st.st_mode) && ioctl(_fd, BLKGETSIZE64, &bytes) != 0) // size of block device is not in stat
+    {
+        throw runtime_error("cannot get size of device " + _name + ": " + strerror(errno));
+    }
+
+    return S_ISBLK(st.st_mode) ? bytes : st.st_size;
+}
+
+void FileHandle::readAt(uint8_t *data, size_t length, uint64_t offset) const
+{
+    while (length > 0)
+    {
+        ssize_t count = pread(_fd, data, length, offset);
+
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            throw runtime_error("cannot read file " + _name + ": " + strerror(errno));
+        }
+
+        if (count == 0)
+        {
+            throw runtime_error("unexpected end of file " + _name);
+        }
+
+        data += count;
+        length -= count;
+        offset += count;
+    }
+}
+
+size_t FileHandle::read(uint8_t *data, size_t length)
+{
+    size_t done = 0;
+
+    while (done < length)
+    {
+        ssize_t count = _regular ? pread(_fd, data + done, length - done, _position + done) :
+                        ::read(_fd, data + done, length - done);
+
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            throw runtime_error("cannot read file " + _name + ": " + strerror(errno));
+        }
+
+        if (count == 0) // end of input
+        {
+            break;
+        }
+
+        done += count;
+    }
+
+    _position += done;
+    return done;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief      Input file descriptor closed on destruction.
+ */
+class FileHandle
+{
+public:
+    /**
+     * @brief      Opens file for reading.
+     *
+     * Name "-" stands for standard input. Pipe buffer of a FIFO or pipe input is
+     * enlarged to reduce the number of reads and writer wake-ups.
+     *
+     * @param[in]  fileName  The file name.
+     *
+     * @throws     std::invalid_argument if file cannot be opened.
+     */
+    FileHandle(const std::string &fileName);
+    ~FileHandle();
+
+    FileHandle(const FileHandle &) = delete;
+    FileHandle &operator=(const FileHandle &) = delete;
+
+    int get() const
+    {
+        return _fd;
+    }
+
+    /**
+     * @brief      Gets the file size, for block device the device size.
+     *
+     * @return     Size in bytes.
+     */
+    size_t size() const;
+
+    /**
+     * @brief      Reads exactly length bytes at offset, retrying short reads.
+     *
+     * @param      data    The destination.
+     * @param[in]  length  The number of bytes.
+     * @param[in]  offset  The file offset.
+     *
+     * @throws     std::runtime_error on read error or end of file.
+     */
+    void readAt(uint8_t *data, size_t length, uint64_t offset) const;
+
+    /**
+     * @brief      Reads the next data of input sequentially, retrying short reads.
+     *
+     * Works for pipes, FIFOs and terminals. Regular files are read with
+     * positional reads from own stream position, so file offset of the
+     * descriptor changed by SparseMap does not matter.
+     *
+     * @param      data    The destination.
+     * @param[in]  length  The number of bytes.
+     *
+     * @return     Number of bytes read, less than length only at the end of input.
+     *
+     * @throws     std::runtime_error on read error.
+     */
+    size_t read(uint8_t *data, size_t length);
+
+    /**
+     * @brief      Moves stream position of regular file forward without reading.
+     *
+     * @param[in]  length  The number of bytes.
+     */
+    void skip(uint64_t length)
+    {
+        _position += length;
+    }
+
+    /**
+     * @brief      Gets stream position, it is the file offset for regular file.
+     */
+    uint64_t position() const
+    {
+        return _position;
+    }
+
+    /**
+     * @brief      Checks that input supports positional reads and mapping.
+     */
+    bool isRegular() const
+    {
+        return _regular;
+    }
+
+    /**
+     * @brief      Checks that file name stands for stream input: standard input, pipe, FIFO or socket.
+     *
+     * Regular file or device on standard input is a stream as well when it is
+     * positioned after its start, only sequential reads begin at the position.
+     *
+     * @param[in]  fileName  The file name.
+     */
+    static bool isStream(const std::string &fileName);
+
+private:
+    int _fd;
+    std::string _name;
+    bool _regular = false;   // regular file or block device
+    uint64_t _position = 0;  // stream position of regular file
+};
@@ -0,0 +1,271 @@
+#include "hash_algorithm.h"
+#include "blake3.h"
+#include "crc32c.h"
+#include "md5_mb.h"
+#include "sha256.h"
+#include "xxh3.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+
+struct Md5Hash
+{
+    static const size_t digestSize = 16;
+};
+
+/**
+ * @brief      Stores CRC big-endian.
+ */
+void storeCrc(uint32_t crc, uint8_t *out)
+{
+    out[0] = static_cast<uint8_t>(crc >> 24);
+    out[1] = static_cast<uint8_t>(crc >> 16);
+    out[2] = static_cast<uint8_t>(crc >> 8);
+    out[3] = static_cast<uint8_t>(crc);
+}
+
+/**
+ * @brief      Incremental CRC32C with the interface of the other streams.
+ */
+class Crc32cStream
+{
+public:
+    void update(const void *data, size_t len)
+    {
+        _crc = crc32cExtend(_crc, data, len);
+    }
+
+    void finish(uint8_t *out)
+    {
+        storeCrc(_crc, out);
+    }
+private:
+    uint32_t _crc = 0;
+};
+
+struct Crc32cHash
+{
+    static const size_t digestSize = 4;
+    typedef Crc32cStream Stream;
+
+    static void hash(const uint8_t *data, size_t len, uint8_t *out)
+    {
+        storeCrc(crc32c(data, len), out);
+    }
+};
+
+struct Xxh128Hash
+{
+    static const size_t digestSize = 16;
+    typedef Xxh128Stream Stream;
+
+    static void hash(const uint8_t *data, size_t len, uint8_t *out)
+    {
+        xxh128(data, len, out);
+    }
+};
+
+struct Blake3Hash
+{
+    static const size_t digestSize = 32;
+    typedef Blake3Stream Stream;
+
+    static void hash(const uint8_t *data, size_t len, uint8_t *out)
+    {
+        blake3(data, len, out);
+    }
+};
+
+struct Sha256Hash
+{
+    static const size_t digestSize = 32;
+    typedef Sha256Stream Stream;
+
+    static void hash(const uint8_t *data, size_t len, uint8_t *out)
+    {
+        sha256(data, len, out);
+    }
+};
+
+template <typename Hash>
+void hashBatch(const uint8_t *const *data, const size_t *lens, size_t count, Digest *out)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[i].resize(Hash::digestSize);
+        Hash::hash(data[i], lens[i], out[i].data());
+    }
+}
+
+// MD5 blocks are hashed together in lanes of the multi-lane kernel
+template <>
+void hashBatch<Md5Hash>(const uint8_t *const *data, const size_t *lens, size_t count, Digest *out)
+{
+    // digests are packed on stack by chunks covering the widest kernel, nothing is allocated per batch
+    const size_t chunk = 64;
+    unsigned char digests[chunk][Md5Hash::digestSize];
+
+    for (size_t first = 0; first < count; first += chunk)
+    {
+        size_t n = min(chunk, count - first);
+        md5binMulti(reinterpret_cast<const void *const *>(data + first), lens + first, n, digests);
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            out[first + i].resize(Md5Hash::digestSize);
+            memcpy(out[first + i].data(), digests[i], Md5Hash::digestSize);
+        }
+    }
+}
+
+/**
+ * @brief      Incremental digests keeping a stream of the algorithm per block.
+ */
+template <typename Hash>
+class HashStreamsOf : public HashStreams
+{
+public:
+    explicit HashStreamsOf(size_t count) : _streams(count) {}
+
+    virtual void update(const uint8_t *const *data, const size_t *lens) override
+    {
+        for (size_t i = 0; i < _streams.size(); ++i)
+        {
+            _streams[i].update(data[i], lens[i]);
+        }
+    }
+
+    virtual void finish(Digest *out) override
+    {
+        for (size_t i = 0; i < _streams.size(); ++i)
+        {
+            out[i].resize(Hash::digestSize);
+            _streams[i].finish(out[i].data());
+        }
+    }
+private:
+    std::vector<typename Hash::Stream> _streams;
+};
+
+// MD5 blocks are hashed together in lanes of the multi-lane kernel
+template <>
+class HashStreamsOf<Md5Hash> : public HashStreams
+{
+public:
+    explicit HashStreamsOf(size_t count) : _md5(count), _count(count) {}
+
+    virtual void update(const uint8_t *const *data, const size_t *lens) override
+    {
+        _md5.update(reinterpret_cast<const void *const *>(data), lens);
+    }
+
+    virtual void finish(Digest *out) override
+    {
+        unique_ptr<unsigned char[][Md5Hash::digestSize]> digests(new unsigned char[_count][Md5Hash::digestSize]);
+        _md5.finish(digests.get());
+
+        for (size_t i = 0; i < _count; ++i)
+        {
+            out[i].resize(Md5Hash::digestSize);
+            memcpy(out[i].data(), digests[i], Md5Hash::digestSize);
+        }
+    }
+private:
+    Md5MultiStream _md5;
+    size_t _count;
+};
+
+template <typename Hash>
+unique_ptr<HashStreams> createStreams(size_t count)
+{
+    return make_unique<HashStreamsOf<Hash>>(count);
+}
+
+/**
+ * @brief      Algorithm description.
+ */
+struct AlgorithmInfo
+{
+    HashAlgorithm algorithm;
+    const char *name;
+    size_t digestSize;
+    HashBatchFunc batch;
+    unique_ptr<HashStreams> (*streams)(size_t count);
+};
+
+const AlgorithmInfo algorithms[] =
+{
+    {HashAlgorithm::Md5, "md5", Md5Hash::digestSize, hashBatch<Md5Hash>, createStreams<Md5Hash>},
+    {HashAlgorithm::Crc32c, "crc32c", Crc32cHash::digestSize, hashBatch<Crc32cHash>, createStreams<Crc32cHash>},
+    {HashAlgorithm::Xxh128, "xxh128", Xxh128Hash::digestSize, hashBatch<Xxh128Hash>, createStreams<Xxh128Hash>},
+    {HashAlgorithm::Blake3, "blake3", Blake3Hash::digestSize, hashBatch<Blake3Hash>, createStreams<Blake3Hash>},
+    {HashAlgorithm::Sha256, "sha256", Sha256Hash::digestSize, hashBatch<Sha256Hash>, createStreams<Sha256Hash>},
+};
+
+const AlgorithmInfo *findAlgorithm(HashAlgorithm algorithm)
+{
+    for (const auto &info : algorithms)
+    {
+        if (info.algorithm == algorithm)
+        {
+            return &info;
+        }
+    }
+
+    return nullptr;
+}
+
+const AlgorithmInfo &algorithmInfo(HashAlgorithm algorithm)
+{
+    const AlgorithmInfo *info = findAlgorithm(algorithm);
+
+    if (info == nullptr)
+    {
+        throw invalid_argument("unknown hash algorithm " + to_string(static_cast<uint32_t>(algorithm)));
+    }
+
+    return *info;
+}
+
+} // namespace
+
+HashAlgorithm parseHashAlgorithm(const string &name)
+{
+    for (const auto &info : algorithms)
+    {
+        if (name == info.name)
+        {
+            return info.algorithm;
+        }
+    }
+
+    throw invalid_argument("unknown hash algorithm " + name);
+}
+
+const char *hashAlgorithmName(HashAlgorithm algorithm)
+{
+    const AlgorithmInfo *info = findAlgorithm(algorithm);
+    return info != nullptr ? info->name : "unknown";
+}
+
+size_t hashDigestSize(HashAlgorithm algorithm)
+{
+    return algorithmInfo(algorithm).digestSize;
+}
+
+HashBatchFunc hashBatchFunc(HashAlgorithm algorithm)
+{
+    return algorithmInfo(algorithm).batch;
+}
+
+unique_ptr<HashStreams> HashStreams::create(HashAlgorithm algorithm, size_t count)
+{
+    return algorithmInfo(algorithm).streams(count);
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/**
+ * @brief      Raw digest of one block, its size depends on the hash algorithm.
+ */
+class Digest
+{
+public:
+    static const size_t maxSize = 32;
+
+    /**
+     * @brief      Constructs zero digest.
+     *
+     * @param[in]  size  The digest size in bytes, at most maxSize.
+     */
+    Digest(size_t size = 16) : _size(size) {}
+
+    uint8_t *data()
+    {
+        return _bytes.data();
+    }
+
+    const uint8_t *data() const
+    {
+        return _bytes.data();
+    }
+
+    size_t size() const
+    {
+        return _size;
+    }
+
+    void resize(size_t size)
+    {
+        _size = size;
+    }
+
+    uint8_t operator[](size_t index) const
+    {
+        return _bytes[index];
+    }
+
+    /**
+     * @brief      Formats lowercase hex digest without allocation.
+     *
+     * @param      out   Destination of 2 * size() characters, not terminated.
+     *
+     * @return     Number of characters written.
+     */
+    size_t toHex(char *out) const
+    {
+        static const char hexDigits[] = "0123456789abcdef";
+
+        for (size_t i = 0; i < _size; ++i)
+        {
+            out[2 * i] = hexDigits[_bytes[i] >> 4];
+            out[2 * i + 1] = hexDigits[_bytes[i] & 0xf];
+        }
+
+        return 2 * _size;
+    }
+
+    /**
+     * @brief      Gets lowercase hex digest, for messages and other output outside hot paths.
+     */
+    std::string hex() const
+    {
+        char out[2 * maxSize];
+        return std::string(out, toHex(out));
+    }
+
+private:
+    std::array<uint8_t, maxSize> _bytes{};
+    size_t _size;
+};
+
+/**
+ * @brief      Block hash algorithms, values are recorded in binary signature header.
+ */
+enum class HashAlgorithm : uint32_t
+{
+    Md5 = 1,
+    Crc32c = 2,  // stored big-endian
+    Xxh128 = 3,  // canonical form
+    Blake3 = 4,
+    Sha256 = 5
+};
+
+/**
+ * @brief      Parses algorithm name: "md5", "crc32c", "xxh128", "blake3" or "sha256".
+ *
+ * @param[in]  name  The name.
+ *
+ * @return     The algorithm.
+ *
+ * @throws     std::invalid_argument for unknown name.
+ */
+HashAlgorithm parseHashAlgorithm(const std::string &name);
+
+/**
+ * @brief      Gets algorithm name accepted by parseHashAlgorithm().
+ *
+ * @param[in]  algorithm  The algorithm.
+ *
+ * @return     The name, "unknown" for values not listed in HashAlgorithm.
+ */
+const char *hashAlgorithmName(HashAlgorithm algorithm);
+
+/**
+ * @brief      Gets digest size of algorithm.
+ *
+ * @param[in]  algorithm  The algorithm.
+ *
+ * @return     Size in bytes.
+ *
+ * @throws     std::invalid_argument for values not listed in HashAlgorithm.
+ */
+size_t hashDigestSize(HashAlgorithm algorithm);
+
+/**
+ * @brief      Hashes several independent blocks.
+ *
+ * @param[in]  data   Block pointers.
+ * @param[in]  lens   Block lengths in bytes.
+ * @param[in]  count  Number of blocks.
+ * @param      out    Digests, one per block.
+ */
+typedef void (*HashBatchFunc)(const uint8_t *const *data, const size_t *lens, size_t count, Digest *out);
+
+/**
+ * @brief      Gets batch function of algorithm.
+ *
+ * Every algorithm has its own instantiation of the hashing loop, so the choice
+ * is made once per hasher and not per block.
+ *
+ * @param[in]  algorithm  The algorithm.
+ *
+ * @return     The function.
+ */
+HashBatchFunc hashBatchFunc(HashAlgorithm algorithm);
+
+/**
+ * @brief      Incremental digests of several blocks fed by parts.
+ *
+ * Lets a block be hashed without holding all of it in memory, digests are the
+ * same as the ones of the batch function. MD5 blocks go through lanes of the
+ * multi-lane kernel, the other algorithms keep a context per block.
+ */
+class HashStreams
+{
+public:
+    virtual ~HashStreams() = default;
+
+    /**
+     * @brief      Hashes the next part of every block.
+     *
+     * @param[in]  data  Part pointers, one per block.
+     * @param[in]  lens  Part lengths in bytes, may be zero.
+     */
+    virtual void update(const uint8_t *const *data, const size_t *lens) = 0;
+
+    /**
+     * @brief      Gets digests of blocks.
+     *
+     * @param      out   Digests, one per block.
+     */
+    virtual void finish(Digest *out) = 0;
+
+    /**
+     * @brief      Starts digests of blocks.
+     *
+     * @param[in]  algorithm  The algorithm.
+     * @param[in]  count      Number of blocks.
+     *
+     * @return     The digests.
+     *
+     * @throws     std::invalid_argument for values not listed in HashAlgorithm.
+     */
+    static std::unique_ptr<HashStreams> create(HashAlgorithm algorithm, size_t count);
+};
@@ -1,21 +1,290 @@
+#include "auto_tuner.h"
+#include "batch_hasher.h"
 #include "block_hasher.h"
+#include "cdc_hasher.h"
+#include "file_handle.h"
+#include "md5_mb.h"
+#include "mmap_hasher.h"
+#include "pread_hasher.h"
+#include "shard.h"
+#include "streaming_hasher.h"
+#include "uring_hasher.h"
 
 #include <algorithm>
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <string>
 #include <vector>
 #include <exception>
 #include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 using namespace std;
 using namespace std::chrono;
 
+extern char **environ;
+
 static void printUsage()
 {
-    cout << "Usage: blockHasher <file to hash> <output file>" << endl;
+    cout << "Usage: blockHasher <file to hash, - for standard input> <output file>" << endl;
     cout << "       [-b <block size in bytes, default is 1 MB>]" << endl;
     cout << "       [-m [threads count, default is 4]" << endl;
+    cout << "       [--huge-pages (back block buffers with huge pages)]" << endl;
+    cout << "       [--mmap (hash blocks directly from memory mapped input)]" << endl;
+    cout << "       [--uring [reads in flight, default is 32] (read input with io_uring)]" << endl;
+    cout << "       [--pread (every thread reads its own blocks)]" << endl;
+    cout << "       [--format <text|binary>, default is text]" << endl;
+    cout << "       [--flush-interval <blocks between output flushes, default is when buffer is full>]" << endl;
+    cout << "       [--algorithm <md5|crc32c|xxh128|blake3|sha256>, default is md5]" << endl;
+    cout << "       [--tree (store Merkle tree root) | --tree-levels (store all Merkle tree levels)]" << endl;
+    cout << "       [--stats [file] (print JSON report of stage counters and latencies)]" << endl;
+    cout << "       [--progress [seconds between progress lines, default is 1]]" << endl;
+    cout << "       [--auto (choose engine and threads not given above), --retune (calibrate again)]" << endl;
+    cout << "       [--cpus <CPU list like 0-7,16> (restrict the run to given CPUs)]" << endl;
+    cout << "       [--numa (bind threads to NUMA nodes and allocate buffers on them)]" << endl;
+    cout << "       [--checkpoint [seconds between checkpoints, default is 10]]" << endl;
+    cout << "       [--resume (continue after checkpoint of interrupted run)]" << endl;
+    cout << "       [--file-digest (store MD5 of the whole input computed in the same pass)]" << endl;
+    cout << "       [--max-memory <bytes> (hash blocks by parts when blocks in flight need more)]" << endl;
+    cout << "       [--offset <bytes>] [--length <bytes>] (write shard signature of block-aligned byte range)" << endl;
+    cout << "       [--shard <index>/<count> (write shard signature of one of count equal block ranges)]" << endl;
+    cout << "       [--processes <count> (hash shards in processes and merge them)]" << endl;
+    cout << "       [--cdc [average chunk size, default is 64 KB] (content-defined chunks instead of blocks)]" << endl;
+    cout << "       [--min-chunk <bytes, default is average / 4>] [--max-chunk <bytes, default is average * 4>]" << endl;
+    cout << "   or: blockHasher <file to hash> --verify <signature> [hashing options above]" << endl;
+    cout << "       [--stop-on-mismatch (stop at the first mismatching block)]" << endl;
+    cout << "   or: blockHasher --batch <directory or file list> <output manifest>" << endl;
+    cout << "       [-b <block size>] [-m [threads count]] [--huge-pages] [--algorithm <name>]" << endl;
+    cout << "       [--stats [file]] [--progress [seconds]] [--cpus <CPU list>] [--numa]" << endl;
+    cout << "   or: blockHasher --convert <input signature> <output signature>" << endl;
+    cout << "       [--format <text|binary>, default is the other one]" << endl;
+    cout << "       [-b <block size recorded when converting text, default is 1 MB>]" << endl;
+    cout << "   or: blockHasher --merge <output signature> <shard signatures...>" << endl;
+    cout << "       [--format <text|binary>, default is the one of the first shard] [--tree | --tree-levels]" << endl;
+}
+
+/**
+ * @brief      Parses positive size given on the command line.
+ *
+ * @param[in]  text  The text.
+ * @param[in]  name  The option name for the error message.
+ *
+ * @return     The size.
+ *
+ * @throws     std::invalid_argument if text is not a number or the number is less than 1.
+ */
+static size_t parsePositive(const string &text, const string &name)
+{
+    long long value = stoll(text);
+
+    if (value < 1)
+    {
+        throw invalid_argument(name + " must be positive");
+    }
+
+    return static_cast<size_t>(value);
+}
+
+/**
+ * @brief      Prints result of verify mode.
+ *
+ * @param[in]  verifier   The verifier after hashing.
+ * @param[in]  blockSize  The block size in bytes.
+ */
+static void printVerifyReport(const SignatureVerifier &verifier, size_t blockSize)
+{
+    if (verifier.passed())
+    {
+        cout << "Verified " << verifier.blockCount() << " blocks, all match" << endl;
+        return;
+    }
+
+    if (!verifier.sizeMatches())
+    {
+        cout << "Input size differs from signature" << endl;
+    }
+
+    for (const auto &range : verifier.mismatches())
+    {
+        cout << "Mismatch in blocks " << range.first << "-" << range.last <<
+             " (bytes from " << range.first * blockSize << ")" << endl;
+    }
+
+    cout << "Verification failed" << endl;
+}
+
+/**
+ * @brief      Prints Merkle tree root of signature.
+ *
+ * @param[in]  signature  The signature with tree.
+ */
+static void printRoot(const SignatureFile &signature)
+{
+    Digest root(signature.header().digestSize);
+
+    if (signature.root() != nullptr)
+    {
+        memcpy(root.data(), signature.root(), root.size());
+    }
+
+    cout << "Merkle tree root " << root.hex() << endl;
+}
+
+/**
+ * @brief      Prints whole-file digest of signature.
+ *
+ * @param[in]  signature  The signature with file digest.
+ */
+static void printFileDigest(const SignatureFile &signature)
+{
+    Digest digest(16);
+
+    if (signature.fileDigest() != nullptr)
+    {
+        memcpy(digest.data(), signature.fileDigest(), digest.size());
+    }
+
+    cout << "File digest md5 " << digest.hex() << endl;
+}
+
+/**
+ * @brief      Statistics and progress reporting requested on the command line.
+ */
+struct StatsOptions
+{
+    bool stats = false;      // print JSON report after hashing
+    string statsFile;   // file of JSON report, standard output if empty
+    double progress = 0;     // seconds between progress lines, 0 to disable
+};
+
+/**
+ * @brief      Prints JSON report of statistics to file or standard output.
+ */
+static void printStats(const PipelineStats &stats, const string &fileName)
+{
+    if (fileName.empty())
+    {
+        cout << stats.toJson() << endl;
+        return;
+    }
+
+    ofstream file(fileName, ios::out | ios::trunc);
+
+    if (!(file << stats.toJson() << endl))
+    {
+        throw runtime_error("cannot write statistics to " + fileName);
+    }
+}
+
+/**
+ * @brief      Hashes input measuring stages when statistics or progress are requested.
+ *
+ * @param      hasher      The hasher.
+ * @param[in]  input       The input file.
+ * @param[in]  output      The output file.
+ * @param[in]  options     The statistics options.
+ * @param[in]  totalBytes  The input size for progress, 0 if unknown.
+ */
+static void runHasher(BlockHasher &hasher, const string &input, const string &output,
+                      const StatsOptions &options, uint64_t totalBytes)
+{
+    if (!options.stats && options.progress <= 0)
+    {
+        hasher.Hash(input, output);
+        return;
+    }
+
+    auto stats = make_shared<PipelineStats>();
+    auto progress = options.progress > 0 ? make_unique<ProgressReporter>(*stats, totalBytes, options.progress) :
+                    nullptr;
+    hasher.setStats(stats);
+
+    try
+    {
+        hasher.Hash(input, output);
+    }
+    catch (...)
+    {
+        progress.reset();
+
+        if (options.stats) // stages of interrupted run are reported as well
+        {
+            printStats(*stats, options.statsFile);
+        }
+
+        throw;
+    }
+
+    progress.reset();
+
+    if (options.stats)
+    {
+        printStats(*stats, options.statsFile);
+    }
+}
+
+/**
+ * @brief      Runs this program once per argument list simultaneously and waits for all runs.
+ *
+ * Standard output of runs is discarded, their errors go to standard error.
+ *
+ * @param[in]  runs  The arguments of every run, without program name.
+ *
+ * @throws     std::runtime_error if a run cannot be started or fails.
+ */
+static void runProcesses(const vector<vector<string>> &runs)
+{
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    vector<pid_t> pids;
+    string error;
+
+    for (size_t i = 0; i < runs.size(); ++i)
+    {
+        vector<char *> argv{const_cast<char *>("blockHasher")};
+
+        for (const auto &arg : runs[i])
+        {
+            argv.push_back(const_cast<char *>(arg.c_str()));
+        }
+
+        argv.push_back(nullptr);
+        pid_t pid;
+        int result = posix_spawn(&pid, "/proc/self/exe", &actions, nullptr, argv.data(), environ);
+
+        if (result != 0)
+        {
+            error = "cannot start process " + to_string(i + 1) + ": " + strerror(result);
+            break;
+        }
+
+        pids.push_back(pid);
+    }
+
+    posix_spawn_file_actions_destroy(&actions);
+
+    // started runs are waited for even when others failed
+    for (size_t i = 0; i < pids.size(); ++i)
+    {
+        int status;
+
+        if ((waitpid(pids[i], &status, 0) != pids[i] || !WIFEXITED(status) || WEXITSTATUS(status) != 0) &&
+                error.empty())
+        {
+            error = "process " + to_string(i + 1) + " of " + to_string(runs.size()) + " failed";
+        }
+    }
+
+    if (!error.empty())
+    {
+        throw runtime_error(error);
+    }
 }
 
 /**
@@ -63,21 +332,235 @@ int main(int argc, char **argv)
 
         size_t blockSize = 1024 * 1024; // 1 MB default block size
         size_t threads = 0; // 0 for single-thread implementation
+        SignatureFormat format = SignatureFormat::Text;
+        HashAlgorithm algorithm = HashAlgorithm::Md5;
 
         auto parser = InputParser(argc, argv);
         auto sizeStr = parser.getCmdOption("-b"); // parsing block size if present
+        auto formatStr = parser.getCmdOption("--format");
+        auto flushStr = parser.getCmdOption("--flush-interval");
+        auto algorithmStr = parser.getCmdOption("--algorithm");
+        size_t flushInterval = 0;
+        StatsOptions statsOptions;
+        double checkpointInterval = 0; // seconds between checkpoints, 0 if disabled
+        size_t chunkAverage = 0, chunkMin = 0, chunkMax = 0; // content-defined chunk sizes, 0 for fixed blocks
+        size_t maxMemory = 0; // budget for block data, 0 if unlimited
+        uint64_t rangeOffset = 0, rangeLength = UINT64_MAX; // byte range of shard, up to the input end by default
+        size_t processes = 0; // shards hashed by processes, 0 to hash in this one
+        vector<int> cpus; // CPUs the run is restricted to, all if empty
 
-        if (!sizeStr.empty())
+        try
         {
-            try
+            if (!sizeStr.empty())
+            {
+                blockSize = parsePositive(sizeStr, "block size");
+            }
+
+            if (!formatStr.empty())
+            {
+                format = parseSignatureFormat(formatStr);
+            }
+
+            if (!flushStr.empty())
+            {
+                flushInterval = stoll(flushStr);
+            }
+
+            if (!algorithmStr.empty())
+            {
+                algorithm = parseHashAlgorithm(algorithmStr);
+            }
+
+            if (parser.cmdOptionExists("--stats"))
+            {
+                auto statsStr = parser.getCmdOption("--stats");
+                statsOptions.stats = true;
+                statsOptions.statsFile = !statsStr.empty() && statsStr[0] != '-' ? statsStr : ""; // file may be omitted
+            }
+
+            auto cpusStr = parser.getCmdOption("--cpus");
+
+            if (!cpusStr.empty())
+            {
+                cpus = parseCpuList(cpusStr);
+            }
+
+            if (parser.cmdOptionExists("--progress"))
+            {
+                auto progressStr = parser.getCmdOption("--progress");
+                statsOptions.progress = !progressStr.empty() && progressStr[0] != '-' ? stod(progressStr) : 1;
+            }
+
+            if (parser.cmdOptionExists("--checkpoint") || parser.cmdOptionExists("--resume"))
+            {
+                auto checkpointStr = parser.getCmdOption("--checkpoint");
+                checkpointInterval = !checkpointStr.empty() && checkpointStr[0] != '-' ? stod(checkpointStr) : 10;
+            }
+
+            auto maxMemoryStr = parser.getCmdOption("--max-memory");
+            auto offsetStr = parser.getCmdOption("--offset");
+            auto lengthStr = parser.getCmdOption("--length");
+            auto processesStr = parser.getCmdOption("--processes");
+
+            if (!offsetStr.empty())
+            {
+                rangeOffset = stoull(offsetStr);
+            }
+
+            if (!lengthStr.empty())
+            {
+                rangeLength = stoull(lengthStr);
+            }
+
+            if (!processesStr.empty())
+            {
+                processes = stoll(processesStr);
+            }
+
+            if (!maxMemoryStr.empty())
+            {
+                maxMemory = parsePositive(maxMemoryStr, "memory budget");
+            }
+
+            if (parser.cmdOptionExists("--cdc"))
+            {
+                auto averageStr = parser.getCmdOption("--cdc");
+                auto minStr = parser.getCmdOption("--min-chunk");
+                auto maxStr = parser.getCmdOption("--max-chunk");
+                chunkAverage = !averageStr.empty() && averageStr[0] != '-' ? stoll(averageStr) : 64 * 1024;
+                chunkMin = !minStr.empty() ? stoll(minStr) : chunkAverage / 4;
+                chunkMax = !maxStr.empty() ? stoll(maxStr) : chunkAverage * 4;
+            }
+        }
+        catch (...)
+        {
+            printUsage();
+            return -1;
+        }
+
+        if (maxMemory > 0 && parser.cmdOptionExists("--file-digest"))
+        {
+            // parts are read out of file order, refused even when whole blocks would fit the budget
+            throw invalid_argument("whole-file digest is not available with memory budget");
+        }
+
+        if (!cpus.empty()) // before any thread is started, so all threads inherit it
+        {
+            restrictProcessCpus(cpus);
+        }
+
+        if (string(argv[1]) == "--convert")
+        {
+            if (argc < 4)
+            {
+                printUsage();
+                return -1;
+            }
+
+            if (formatStr.empty()) // converting to the other format by default
+            {
+                format = SignatureFile(argv[2]).format() == SignatureFormat::Text ?
+                         SignatureFormat::Binary : SignatureFormat::Text;
+            }
+
+            convertSignature(argv[2], argv[3], format, blockSize);
+            cout << "Converted " << argv[2] << " to " << argv[3] << endl;
+            return 0;
+        }
+
+        if (string(argv[1]) == "--merge")
+        {
+            vector<string> shards; // shards follow the output up to the first option
+
+            for (int i = 3; i < argc && argv[i][0] != '-'; ++i)
             {
-                blockSize = stoll(sizeStr);
+                shards.push_back(argv[i]);
             }
-            catch (...)
+
+            if (shards.empty())
             {
                 printUsage();
                 return -1;
             }
+
+            if (formatStr.empty())
+            {
+                format = SignatureFile(shards.front()).format();
+            }
+
+            TreeMode tree = parser.cmdOptionExists("--tree-levels") ? TreeMode::Levels :
+                            parser.cmdOptionExists("--tree") ? TreeMode::Root : TreeMode::None;
+            SignatureHeader merged = mergeShards(shards, argv[2], format, tree);
+            cout << "Merged " << shards.size() << " shards of " << merged.blockCount << " blocks to " << argv[2] <<
+                 endl;
+
+            if (tree != TreeMode::None)
+            {
+                printRoot(SignatureFile(argv[2]));
+            }
+
+            return 0;
+        }
+
+        if (string(argv[1]) == "--batch")
+        {
+            if (argc < 4)
+            {
+                printUsage();
+                return -1;
+            }
+
+            auto start = steady_clock::now();
+            auto threadsStr = parser.getCmdOption("-m");
+
+            if (!threadsStr.empty() && threadsStr[0] != '-')
+            {
+                threads = stoll(threadsStr);
+            }
+
+            threads = threads > 0 ? threads : 4;
+            BatchHasher hasher(blockSize, threads, parser.cmdOptionExists("--huge-pages"));
+            hasher.setAlgorithm(algorithm);
+            hasher.setFlushInterval(flushInterval);
+            hasher.setNuma(parser.cmdOptionExists("--numa"));
+            cout << "Batch mode, max " << threads << " threads, hashing " << argv[2] << " by blocks of " <<
+                 blockSize << " bytes with " << hashAlgorithmName(algorithm) << " to manifest " << argv[3] << endl;
+
+            runHasher(hasher, argv[2], argv[3], statsOptions, 0);
+            auto msec = duration_cast<milliseconds>(steady_clock::now() - start).count();
+            cout << "Hashed " << hasher.fileCount() << " files in " << msec << " milliseconds" << endl;
+            return 0;
+        }
+
+        shared_ptr<SignatureVerifier> verifier;
+        auto verifyStr = parser.getCmdOption("--verify");
+
+        if (!verifyStr.empty())
+        {
+            auto expected = make_shared<SignatureFile>(verifyStr);
+            const SignatureHeader &header = expected->header();
+            auto expectedAlgorithm = static_cast<HashAlgorithm>(header.algorithm);
+
+            if (algorithmStr.empty())
+            {
+                algorithm = expectedAlgorithm; // input is hashed the same way as the signature
+            }
+            else if (algorithm != expectedAlgorithm)
+            {
+                throw invalid_argument(string("signature is hashed with ") + hashAlgorithmName(expectedAlgorithm));
+            }
+
+            if (header.blockSize > 0) // known for binary signature
+            {
+                if (!sizeStr.empty() && blockSize != header.blockSize)
+                {
+                    throw invalid_argument("signature block size is " + to_string(header.blockSize));
+                }
+
+                blockSize = header.blockSize;
+            }
+
+            verifier = make_shared<SignatureVerifier>(expected, parser.cmdOptionExists("--stop-on-mismatch"));
         }
 
         unique_ptr<BlockHasher> hasherPtr;
@@ -91,37 +574,357 @@ int main(int argc, char **argv)
         }
 
         auto threadsStr = parser.getCmdOption("-m");// parsing threads count if present
+        bool threadsPinned = !threadsStr.empty() && threadsStr[0] != '-'; // count may be omitted before other option
+        size_t queueDepth = 32; // default number of reads in flight
+        auto depthStr = parser.getCmdOption("--uring");
+        bool depthPinned = !depthStr.empty() && depthStr[0] != '-';
 
-        if (!threadsStr.empty())
+        try
         {
-            try
+            threads = threadsPinned ? stoll(threadsStr) : threads;
+            queueDepth = depthPinned ? stoll(depthStr) : queueDepth;
+        }
+        catch (...)
+        {
+            printUsage();
+            return -1;
+        }
+
+        bool hugePages = parser.cmdOptionExists("--huge-pages");
+        // pipes and standard input can be read only sequentially
+        bool stream = FileHandle::isStream(input);
+        IoEngine engine = threads > 0 ? IoEngine::Multi : IoEngine::Single;
+        bool enginePinned = true;
+
+        if (stream && (parser.cmdOptionExists("--mmap") || parser.cmdOptionExists("--uring") ||
+                       parser.cmdOptionExists("--pread")))
+        {
+            cout << "Input is a stream, reading it sequentially" << endl;
+        }
+        else if (parser.cmdOptionExists("--mmap"))
+        {
+            engine = IoEngine::Mmap;
+        }
+        else if (parser.cmdOptionExists("--uring"))
+        {
+            engine = IoEngine::Uring;
+        }
+        else if (parser.cmdOptionExists("--pread"))
+        {
+            engine = IoEngine::Pread;
+        }
+        else
+        {
+            enginePinned = false;
+        }
+
+        if (parser.cmdOptionExists("--auto") && !stream)
+        {
+            // only parameters not given on command line are tuned, block size is never changed
+            AutoTuner tuner(blockSize, algorithm);
+            Tuning tuning = tuner.tune(input, parser.cmdOptionExists("--retune"));
+
+            const char *origin = tuning.cached ? "cached" : tuning.hashRate > 0 ? "calibrated" : "small input";
+            cout << "Auto tuning (" << origin << "): " << ioEngineName(tuning.engine) << ", " <<
+                 tuning.threads << " threads";
+
+            if (tuning.hashRate > 0)
             {
-                threads = stoll(threadsStr);
+                cout << ", hashing " << static_cast<uint64_t>(tuning.hashRate / 1e6) << " MB/s per thread, reading " <<
+                     static_cast<uint64_t>(tuning.readRate / 1e6) << " MB/s";
             }
-            catch (...)
+
+            cout << endl;
+            threads = threadsPinned ? threads : tuning.threads;
+
+            if (!enginePinned) // pinned thread count still asks for a multi-thread engine
             {
-                printUsage();
-                return -1;
+                engine = tuning.engine == IoEngine::Single && threadsPinned ? IoEngine::Multi : tuning.engine;
             }
+
+            queueDepth = depthPinned ? queueDepth : tuning.queueDepth;
         }
 
-        if (threads > 0)
+        bool fileDigest = parser.cmdOptionExists("--file-digest");
+
+        if (fileDigest && engine == IoEngine::Pread && !enginePinned)
         {
-            hasherPtr = make_unique<MultiThreadHasher>(blockSize, threads);
-            cout << "Multithreading mode, max " << threads << " threads" << endl;
+            engine = IoEngine::Multi; // positional reads come in any order, the file digest needs them in order
+        }
+
+        if (engine != IoEngine::Single)
+        {
+            threads = max(threads, static_cast<size_t>(1));
+        }
+
+        auto shardStr = parser.getCmdOption("--shard");
+        bool sharded = !shardStr.empty() || parser.cmdOptionExists("--offset") || parser.cmdOptionExists("--length");
+        TreeMode tree = parser.cmdOptionExists("--tree-levels") ? TreeMode::Levels :
+                        parser.cmdOptionExists("--tree") ? TreeMode::Root : TreeMode::None;
+        ShardRange range; // whole input unless a shard is hashed
+
+        if (sharded || processes > 1)
+        {
+            if (stream || verifier || fileDigest || chunkAverage > 0 || blockSize == 0)
+            {
+                throw invalid_argument("shards are hashed by blocks of regular input to a new signature "
+                                       "without file digest");
+            }
+
+            if (sharded && (tree != TreeMode::None || processes > 1))
+            {
+                throw invalid_argument("shard has no Merkle tree and is not split further, --merge builds the tree");
+            }
+        }
+
+        if (sharded)
+        {
+            uint64_t inputSize = FileHandle(input).size();
+            size_t shardIndex = 0, shardCount = 0;
+
+            if (!shardStr.empty())
+            {
+                parseShard(shardStr, shardIndex, shardCount);
+                range = shardBlocks(inputSize, blockSize, shardIndex, shardCount);
+            }
+            else
+            {
+                range = byteBlocks(inputSize, blockSize, rangeOffset, rangeLength);
+            }
+        }
+
+        if (processes > 1)
+        {
+            // every process writes shard signature next to the output, shards are merged when all are done
+            vector<string> shards;
+            vector<vector<string>> runs;
+
+            for (size_t i = 1; i <= processes; ++i)
+            {
+                shards.push_back(output + ".shard" + to_string(i));
+                vector<string> args{input, shards.back(), "-b", to_string(blockSize),
+                                    "--algorithm", hashAlgorithmName(algorithm),
+                                    "--format", format == SignatureFormat::Binary ? "binary" : "text",
+                                    "--shard", to_string(i) + "/" + to_string(processes)};
+
+                if (threads > 0)
+                {
+                    args.insert(args.end(), {"-m", to_string(threads)});
+                }
+
+                if (engine == IoEngine::Mmap)
+                {
+                    args.push_back("--mmap");
+                }
+                else if (engine == IoEngine::Uring)
+                {
+                    args.insert(args.end(), {"--uring", to_string(queueDepth)});
+                }
+                else if (engine == IoEngine::Pread)
+                {
+                    args.push_back("--pread");
+                }
+
+                if (hugePages)
+                {
+                    args.push_back("--huge-pages");
+                }
+
+                if (parser.cmdOptionExists("--numa"))
+                {
+                    args.push_back("--numa");
+                }
+
+                if (maxMemory > 0)
+                {
+                    args.insert(args.end(), {"--max-memory", to_string(maxMemory)});
+                }
+
+                if (flushInterval > 0)
+                {
+                    args.insert(args.end(), {"--flush-interval", to_string(flushInterval)});
+                }
+
+                if (checkpointInterval > 0) // every shard is resumed on its own
+                {
+                    args.insert(args.end(), {"--checkpoint", to_string(checkpointInterval)});
+
+                    if (parser.cmdOptionExists("--resume"))
+                    {
+                        args.push_back("--resume");
+                    }
+                }
+
+                runs.push_back(move(args));
+            }
+
+            cout << "Multi-process mode, " << processes << " processes, " << ioEngineName(engine) << " engine with " <<
+                 max(threads, static_cast<size_t>(1)) << " threads each" << endl;
+            cout << "Hashing " << input << " by blocks of " << blockSize << " bytes with " <<
+                 hashAlgorithmName(algorithm) << " to shards " << output << ".shard<index>" << endl;
+
+            runProcesses(runs);
+            mergeShards(shards, output, format, tree);
+
+            for (const auto &shard : shards)
+            {
+                unlink(shard.c_str());
+            }
+
+            auto msec = duration_cast<milliseconds>(steady_clock::now() - start).count();
+            cout << "Merged shards to file " << output << endl;
+            cout << "Hashed in " << msec << " milliseconds" << endl;
+
+            if (tree != TreeMode::None)
+            {
+                printRoot(SignatureFile(output));
+            }
+
+            return 0;
+        }
+
+        if (chunkAverage > 0)
+        {
+            if (verifier || checkpointInterval > 0 || format != SignatureFormat::Text || fileDigest ||
+                    parser.cmdOptionExists("--tree") || parser.cmdOptionExists("--tree-levels"))
+            {
+                throw invalid_argument("content-defined chunks are written only as text chunk list");
+            }
+
+            if (maxMemory > 0)
+            {
+                throw invalid_argument("memory budget is not available for content-defined chunks");
+            }
+
+            Chunker chunker(chunkMin, chunkAverage, chunkMax);
+            threads = max(threads, static_cast<size_t>(1));
+            hasherPtr = make_unique<CdcHasher>(chunker, threads, hugePages);
+            cout << "Content-defined chunking mode, chunks of " << chunkMin << "-" << chunkMax << " bytes, " <<
+                 Chunker::kernel() << " scan, max " << threads << " threads" << endl;
+        }
+        else if (maxMemory > 0 &&
+                 (engine == IoEngine::Single ? 1 : threads + 1) * md5MultiLanes() * blockSize > maxMemory)
+        {
+            // batches of whole blocks in flight do not fit the budget
+            threads = max(threads, static_cast<size_t>(1));
+            auto streaming = make_unique<StreamingHasher>(blockSize, threads, maxMemory, hugePages);
+            cout << "Memory-bounded mode, blocks are hashed by parts of " << streaming->partSize() <<
+                 " bytes, max " << threads << " threads" << endl;
+            hasherPtr = move(streaming);
         }
         else
         {
-            hasherPtr = make_unique<SingleThreadHasher>(blockSize);
-            cout << "Single-thread mode" << endl;
+            switch (engine)
+            {
+            case IoEngine::Mmap:
+                hasherPtr = make_unique<MmapHasher>(blockSize, threads);
+                cout << "Memory mapped mode, max " << threads << " threads" << endl;
+                break;
+            case IoEngine::Uring:
+                hasherPtr = make_unique<UringHasher>(blockSize, threads, queueDepth, hugePages);
+                cout << "io_uring mode, " << queueDepth << " reads in flight, max " << threads << " threads" << endl;
+                break;
+            case IoEngine::Pread:
+                hasherPtr = make_unique<PreadHasher>(blockSize, threads, hugePages);
+                cout << "Positional read mode, max " << threads << " threads" << endl;
+                break;
+            case IoEngine::Multi:
+                hasherPtr = make_unique<MultiThreadHasher>(blockSize, threads, hugePages);
+                cout << "Multithreading mode, max " << threads << " threads" << endl;
+                break;
+            default:
+                hasherPtr = make_unique<SingleThreadHasher>(blockSize, hugePages);
+                cout << "Single-thread mode" << endl;
+            }
+        }
+
+        uint64_t totalBytes = stream ? 0 : FileHandle(input).size(); // for progress
+        hasherPtr->setFormat(format);
+        hasherPtr->setFlushInterval(flushInterval);
+        hasherPtr->setAlgorithm(algorithm);
+        hasherPtr->setNuma(parser.cmdOptionExists("--numa"));
+
+        if (sharded)
+        {
+            hasherPtr->setShard(range);
+            cout << "Shard from block " << range.first << (range.count == ShardRange::toEnd ? " to the input end" :
+                                                           ", " + to_string(range.count) + " blocks") << endl;
+        }
+
+        if (parser.cmdOptionExists("--tree-levels"))
+        {
+            hasherPtr->setTree(TreeMode::Levels);
+        }
+        else if (parser.cmdOptionExists("--tree"))
+        {
+            hasherPtr->setTree(TreeMode::Root);
+        }
+
+        if (fileDigest)
+        {
+            if (verifier)
+            {
+                throw invalid_argument("whole-file digest is written only to a new signature");
+            }
+
+            hasherPtr->setFileDigest(true);
+        }
+
+        if (checkpointInterval > 0)
+        {
+            if (verifier || stream)
+            {
+                throw invalid_argument("checkpoints need a regular input file and an output signature");
+            }
+
+            hasherPtr->setCheckpoint(checkpointInterval, parser.cmdOptionExists("--resume"));
+        }
+
+        if (verifier)
+        {
+            hasherPtr->setVerifier(verifier);
+            cout << "Verifying " << input << " by blocks of " << blockSize <<
+                 " bytes with " << hashAlgorithmName(algorithm) << " against " << verifyStr << endl;
+
+            try
+            {
+                runHasher(*hasherPtr, input, output, statsOptions, totalBytes);
+            }
+            catch (const SignatureMismatch &)
+            {
+                // stopped at the first mismatch, it is already recorded
+            }
+
+            auto msec = duration_cast<milliseconds>(steady_clock::now() - start).count();
+            printVerifyReport(*verifier, blockSize);
+            cout << "Verified in " << msec << " milliseconds" << endl;
+            return verifier->passed() ? 0 : 1;
         }
 
-        cout << "Hashing " << input << " by blocks of " << blockSize <<
-             " bytes to file " << output << endl;
+        cout << "Hashing " << input << " by " << (chunkAverage > 0 ? "chunks of average " : "blocks of ") <<
+             (chunkAverage > 0 ? chunkAverage : blockSize) << " bytes with " << hashAlgorithmName(algorithm) <<
+             " to file " << output << endl;
 
-        hasherPtr->Hash(input, output);
+        runHasher(*hasherPtr, input, output, statsOptions, totalBytes);
         auto msec = duration_cast<milliseconds>(steady_clock::now() - start).count();
+
+        if (hasherPtr->firstBlock() > range.first)
+        {
+            cout << "Resumed after " << hasherPtr->firstBlock() - range.first << " blocks of interrupted run" << endl;
+        }
+
         cout << "Hashed in " << msec << " milliseconds" << endl;
+
+        if (parser.cmdOptionExists("--tree") || parser.cmdOptionExists("--tree-levels"))
+        {
+            SignatureFile signature(output);
+            printRoot(signature);
+        }
+
+        if (fileDigest)
+        {
+            printFileDigest(SignatureFile(output));
+        }
     }
     catch (const exception &e)
     {
@@ -238,6 +238,25 @@ void md5bin(const void* dat, size_t len, unsigned char out[16]) {
     MD5_Final(out, &c);
 }
 
+struct Md5Stream::Context {
+    MD5_CTX ctx;
+};
+
+Md5Stream::Md5Stream() : _context(new Context) {
+    MD5_Init(&_context->ctx);
+}
+
+Md5Stream::~Md5Stream() = default;
+
+void Md5Stream::update(const void* dat, size_t len) {
+    MD5_Update(&_context->ctx, dat, len);
+}
+
+void Md5Stream::finish(unsigned char out[16]) {
+    MD5_Final(out, &_context->ctx);
+    MD5_Init(&_context->ctx);
+}
+
 static char hb2hex(unsigned char hb) {
     hb = hb & 0xF;
     return hb < 10 ? '0' + hb : hb - 10 + 'a';
@@ -271,17 +290,21 @@ string md5file(std::FILE* file){
 	return res;
 }
 
-string md5(const void* dat, size_t len) {
+string md5hex(const unsigned char digest[16]) {
     string res;
-    unsigned char out[16];
-    md5bin(dat, len, out);
     for(size_t i = 0; i < 16; ++ i) {
-        res.push_back(hb2hex(out[i] >> 4));
-        res.push_back(hb2hex(out[i]));
+        res.push_back(hb2hex(digest[i] >> 4));
+        res.push_back(hb2hex(digest[i]));
     }
     return res;
 }
 
+string md5(const void* dat, size_t len) {
+    unsigned char out[16];
+    md5bin(dat, len, out);
+    return md5hex(out);
+}
+
 std::string md5(std::string dat){
 	return md5(dat.c_str(), dat.length());
 }
@@ -2,12 +2,27 @@
 
 #define _CRT_SECURE_NO_WARNINGS
 
+#include <memory>
 #include <string>
 #include <cstring>
 
 std::string md5(std::string dat);
 std::string md5(const void* dat, size_t len);
+void md5bin(const void* dat, size_t len, unsigned char out[16]);
+std::string md5hex(const unsigned char digest[16]);
 std::string md5file(const char* filename);
 std::string md5file(std::FILE* file);
 std::string md5sum6(std::string dat);
 std::string md5sum6(const void* dat, size_t len);
+
+/* Incremental MD5, digest of data given by parts is the same as md5bin() of their concatenation */
+class Md5Stream {
+public:
+    Md5Stream();
+    ~Md5Stream();
+    void update(const void* dat, size_t len);
+    void finish(unsigned char out[16]);
+private:
+    struct Context;
+    std::unique_ptr<Context> _context;
+};
@@ -0,0 +1,219 @@
+#include "md5_mb.h"
+#include "md5_mb_kernel.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+typedef void (*Md5MultiFunc)(const uint8_t *const *, const size_t *, size_t, uint8_t (*)[16]);
+typedef void (*Md5BlocksFunc)(uint32_t *, const uint8_t *const *, size_t, size_t);
+
+#if defined(__x86_64__) || defined(__i386__)
+// implemented in translation units compiled with the matching target flags
+void md5MultiSse2(const uint8_t *const *data, const size_t *lens, size_t count, uint8_t (*out)[16]);
+void md5MultiAvx2(const uint8_t *const *data, const size_t *lens, size_t count, uint8_t (*out)[16]);
+void md5MultiAvx512(const uint8_t *const *data, const size_t *lens, size_t count, uint8_t (*out)[16]);
+void md5BlocksSse2(uint32_t *state, const uint8_t *const *data, size_t count, size_t blocks);
+void md5BlocksAvx2(uint32_t *state, const uint8_t *const *data, size_t count, size_t blocks);
+void md5BlocksAvx512(uint32_t *state, const uint8_t *const *data, size_t count, size_t blocks);
+#endif
+
+static void md5MultiScalar(const uint8_t *const *data, const size_t *lens, size_t count, uint8_t (*out)[16])
+{
+    md5MultiLane<uint32_t, 1>(data, lens, count, out);
+}
+
+static void md5BlocksScalar(uint32_t *state, const uint8_t *const *data, size_t count, size_t blocks)
+{
+    md5MultiBlocks<uint32_t, 1>(state, data, count, blocks);
+}
+
+/**
+ * @brief      Selected kernel description.
+ */
+struct Md5Kernel
+{
+    Md5MultiFunc func;
+    Md5BlocksFunc blocks;
+    size_t lanes;
+    const char *name;
+};
+
+static Md5Kernel selectKernel()
+{
+    Md5Kernel kernels[] =
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        {md5MultiAvx512, md5BlocksAvx512, 16, "avx512"},
+        {md5MultiAvx2, md5BlocksAvx2, 8, "avx2"},
+        {md5MultiSse2, md5BlocksSse2, 4, "sse2"},
+#endif
+        {md5MultiScalar, md5BlocksScalar, 1, "scalar"},
+    };
+
+    auto supported = [](const Md5Kernel &kernel)
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_cpu_init();
+        string name(kernel.name);
+
+        if (name == "avx512")
+        {
+            return __builtin_cpu_supports("avx512f") != 0;
+        }
+        if (name == "avx2")
+        {
+            return __builtin_cpu_supports("avx2") != 0;
+        }
+        if (name == "sse2")
+        {
+            return __builtin_cpu_supports("sse2") != 0;
+        }
+#endif
+        return true;
+    };
+
+    const char *forced = getenv("BLOCKHASHER_MD5_KERNEL");
+
+    if (forced != nullptr)
+    {
+        for (const auto &kernel : kernels)
+        {
+            if (string(forced) == kernel.name && supported(kernel))
+            {
+                return kernel;
+            }
+        }
+    }
+
+    for (const auto &kernel : kernels)
+    {
+        if (supported(kernel))
+        {
+            return kernel;
+        }
+    }
+
+    return kernels[0];
+}
+
+static const Md5Kernel &kernel()
+{
+    static const Md5Kernel selected = selectKernel();
+    return selected;
+}
+
+void md5binMulti(const void *const *data, const size_t *lens, size_t count, unsigned char (*out)[16])
+{
+    kernel().func(reinterpret_cast<const uint8_t *const *>(data), lens, count, out);
+}
+
+size_t md5MultiLanes()
+{
+    return kernel().lanes;
+}
+
+const char *md5MultiKernel()
+{
+    return kernel().name;
+}
+
+Md5MultiStream::Md5MultiStream(size_t count) : _state(count * 4), _buffer(count * 64), _length(count, 0)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        _state[i * 4] = 0x67452301;
+        _state[i * 4 + 1] = 0xefcdab89;
+        _state[i * 4 + 2] = 0x98badcfe;
+        _state[i * 4 + 3] = 0x10325476;
+    }
+}
+
+void Md5MultiStream::update(const void *const *data, const size_t *lens)
+{
+    size_t count = _length.size();
+    vector<const uint8_t *> rest(count); // data following the completed partial block
+    vector<size_t> restLens(count);
+    size_t common = SIZE_MAX; // full blocks every message has
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto input = static_cast<const uint8_t *>(data[i]);
+        size_t len = lens[i];
+        size_t buffered = _length[i] % 64;
+        _length[i] += len;
+
+        if (buffered > 0)
+        {
+            size_t take = min(len, 64 - buffered);
+            memcpy(&_buffer[i * 64 + buffered], input, take);
+            input += take;
+            len -= take;
+
+            if (buffered + take == 64)
+            {
+                const uint8_t *block = &_buffer[i * 64];
+                md5BlocksScalar(&_state[i * 4], &block, 1, 1);
+            }
+        }
+
+        rest[i] = input;
+        restLens[i] = len;
+        common = min(common, len / 64);
+    }
+
+    if (count > 0 && common > 0)
+    {
+        kernel().blocks(_state.data(), rest.data(), count, common);
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const uint8_t *input = rest[i] + common * 64;
+        size_t len = restLens[i] - common * 64;
+
+        if (len >= 64)
+        {
+            md5BlocksScalar(&_state[i * 4], &input, 1, len / 64);
+            input += len / 64 * 64;
+            len %= 64;
+        }
+
+        memcpy(&_buffer[i * 64], input, len);
+    }
+}
+
+void Md5MultiStream::finish(unsigned char (*out)[16])
+{
+    for (size_t i = 0; i < _length.size(); ++i)
+    {
+        uint8_t tail[128] = {};
+        size_t buffered = _length[i] % 64;
+        size_t tailLen = buffered < 56 ? 64 : 128;
+        uint64_t bits = _length[i] << 3;
+
+        memcpy(tail, &_buffer[i * 64], buffered);
+        tail[buffered] = 0x80;
+
+        for (size_t k = 0; k < 8; ++k)
+        {
+            tail[tailLen - 8 + k] = static_cast<uint8_t>(bits >> (8 * k));
+        }
+
+        const uint8_t *block = tail;
+        md5BlocksScalar(&_state[i * 4], &block, 1, tailLen / 64);
+
+        for (size_t word = 0; word < 4; ++word)
+        {
+            for (size_t k = 0; k < 4; ++k)
+            {
+                out[i][word * 4 + k] = static_cast<uint8_t>(_state[i * 4 + word] >> (8 * k));
+            }
+        }
+    }
+}
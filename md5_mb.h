@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief      Calculates MD5 digests of several independent messages at once.
+ *
+ * Messages are interleaved in vector registers (4 lanes with SSE2, 8 with AVX2,
+ * 16 with AVX-512), the widest kernel supported by the CPU is picked at first call.
+ * Digests are identical to the ones of md5bin().
+ *
+ * @param[in]  data   Message pointers.
+ * @param[in]  lens   Message lengths in bytes.
+ * @param[in]  count  Number of messages, any value is accepted.
+ * @param      out    Raw digests, 16 bytes per message.
+ */
+void md5binMulti(const void *const *data, const size_t *lens, size_t count, unsigned char (*out)[16]);
+
+/**
+ * @brief      Number of messages hashed simultaneously by the selected kernel.
+ *
+ * @return     Lanes count, 1 for the scalar kernel.
+ */
+size_t md5MultiLanes();
+
+/**
+ * @brief      Name of the selected kernel: "scalar", "sse2", "avx2" or "avx512".
+ *
+ * Kernel can be forced by BLOCKHASHER_MD5_KERNEL environment variable,
+ * unsupported kernel falls back to automatic choice.
+ *
+ * @return     Kernel name.
+ */
+const char *md5MultiKernel();
+
+/**
+ * @brief      Incremental MD5 of several independent messages fed by parts.
+ *
+ * Every update() gives the next part of every message, digests are the same
+ * as md5binMulti() of the concatenated parts. Full blocks all messages have in
+ * the part go through the selected kernel in lockstep, the rest of a message
+ * is buffered or hashed one lane at a time, so parts of equal length keep all
+ * lanes busy.
+ */
+class Md5MultiStream
+{
+public:
+    /**
+     * @brief      Starts digests of messages.
+     *
+     * @param[in]  count  Number of messages.
+     */
+    explicit Md5MultiStream(size_t count);
+
+    /**
+     * @brief      Hashes the next part of every message.
+     *
+     * @param[in]  data  Part pointers, one per message.
+     * @param[in]  lens  Part lengths in bytes, may be zero.
+     */
+    void update(const void *const *data, const size_t *lens);
+
+    /**
+     * @brief      Gets digests.
+     *
+     * @param      out   Raw digests, 16 bytes per message.
+     */
+    void finish(unsigned char (*out)[16]);
+private:
+    std::vector<uint32_t> _state;   // MD5 state, 4 words per message
+    std::vector<uint8_t> _buffer;   // partial block, 64 bytes per message
+    std::vector<uint64_t> _length;  // bytes hashed per message
+};
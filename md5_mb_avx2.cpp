@@ -0,0 +1,17 @@
+#include "md5_mb_kernel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+typedef uint32_t Md5Vec8 __attribute__((vector_size(32)));
+
+void md5MultiAvx2(const uint8_t *const *data, const size_t *lens, size_t count, uint8_t (*out)[16])
+{
+    md5MultiLane<Md5Vec8, 8>(data, lens, count, out);
+}
+
+void md5BlocksAvx2(uint32_t *state, const uint8_t *const *data, size_t count, size_t blocks)
+{
+    md5MultiBlocks<Md5Vec8, 8>(state, data, count, blocks);
+}
+
+#endif
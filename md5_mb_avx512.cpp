@@ -0,0 +1,17 @@
+#include "md5_mb_kernel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+typedef uint32_t Md5Vec16 __attribute__((vector_size(64)));
+
+void md5MultiAvx512(const uint8_t *const *data, const size_t *lens, size_t count, uint8_t (*out)[16])
+{
+    md5MultiLane<Md5Vec16, 16>(data, lens, count, out);
+}
+
+void md5BlocksAvx512(uint32_t *state, const uint8_t *const *data, size_t count, size_t blocks)
+{
+    md5MultiBlocks<Md5Vec16, 16>(state, data, count, blocks);
+}
+
+#endif
@@ -0,0 +1,331 @@
+#pragma once
+
+/*
+ * Multi-lane MD5 compression kernel.
+ *
+ * This header is included by every translation unit that provides a lane width
+ * (scalar, SSE2, AVX2, AVX-512). Each of them is compiled with its own target
+ * flags, so everything here has internal linkage to keep instantiations from
+ * different units apart.
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace
+{
+
+template <typename V>
+inline V md5Rotl(V x, int s)
+{
+    return (x << s) | (x >> (32 - s));
+}
+
+#define MD5_MB_F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define MD5_MB_G(x, y, z) ((y) ^ ((z) & ((x) ^ (y))))
+#define MD5_MB_H(x, y, z) ((x) ^ (y) ^ (z))
+#define MD5_MB_I(x, y, z) ((y) ^ ((x) | ~(z)))
+#define MD5_MB_STEP(f, a, b, c, d, x, t, s) \
+    (a) += f((b), (c), (d)) + (x) + static_cast<uint32_t>(t); \
+    (a) = md5Rotl((a), (s)) + (b);
+
+/**
+ * @brief      Runs MD5 compression of one 64-byte block per lane.
+ *
+ * @param      state   The lane states, state[word][lane].
+ * @param[in]  blocks  Pointers to the blocks, one per lane.
+ *
+ * @tparam     V       Vector type of N 32-bit words (or uint32_t for N = 1).
+ * @tparam     N       Number of lanes.
+ */
+template <typename V, size_t N>
+inline void md5Compress(uint32_t (&state)[4][N], const uint8_t *const (&blocks)[N])
+{
+    alignas(64) uint32_t words[16][N];
+
+    for (size_t lane = 0; lane < N; ++lane)
+    {
+        const uint8_t *p = blocks[lane];
+
+        for (size_t i = 0; i < 16; ++i, p += 4)
+        {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            memcpy(&words[i][lane], p, 4);
+#else
+            words[i][lane] = static_cast<uint32_t>(p[0]) |
+                             static_cast<uint32_t>(p[1]) << 8 |
+                             static_cast<uint32_t>(p[2]) << 16 |
+                             static_cast<uint32_t>(p[3]) << 24;
+#endif
+        }
+    }
+
+    V x[16];
+    V a, b, c, d;
+    memcpy(&a, state[0], sizeof(V));
+    memcpy(&b, state[1], sizeof(V));
+    memcpy(&c, state[2], sizeof(V));
+    memcpy(&d, state[3], sizeof(V));
+
+    for (size_t i = 0; i < 16; ++i)
+    {
+        memcpy(&x[i], words[i], sizeof(V));
+    }
+
+    V sa = a, sb = b, sc = c, sd = d;
+
+    MD5_MB_STEP(MD5_MB_F, a, b, c, d, x[0], 0xd76aa478, 7)
+    MD5_MB_STEP(MD5_MB_F, d, a, b, c, x[1], 0xe8c7b756, 12)
+    MD5_MB_STEP(MD5_MB_F, c, d, a, b, x[2], 0x242070db, 17)
+    MD5_MB_STEP(MD5_MB_F, b, c, d, a, x[3], 0xc1bdceee, 22)
+    MD5_MB_STEP(MD5_MB_F, a, b, c, d, x[4], 0xf57c0faf, 7)
+    MD5_MB_STEP(MD5_MB_F, d, a, b, c, x[5], 0x4787c62a, 12)
+    MD5_MB_STEP(MD5_MB_F, c, d, a, b, x[6], 0xa8304613, 17)
+    MD5_MB_STEP(MD5_MB_F, b, c, d, a, x[7], 0xfd469501, 22)
+    MD5_MB_STEP(MD5_MB_F, a, b, c, d, x[8], 0x698098d8, 7)
+    MD5_MB_STEP(MD5_MB_F, d, a, b, c, x[9], 0x8b44f7af, 12)
+    MD5_MB_STEP(MD5_MB_F, c, d, a, b, x[10], 0xffff5bb1, 17)
+    MD5_MB_STEP(MD5_MB_F, b, c, d, a, x[11], 0x895cd7be, 22)
+    MD5_MB_STEP(MD5_MB_F, a, b, c, d, x[12], 0x6b901122, 7)
+    MD5_MB_STEP(MD5_MB_F, d, a, b, c, x[13], 0xfd987193, 12)
+    MD5_MB_STEP(MD5_MB_F, c, d, a, b, x[14], 0xa679438e, 17)
+    MD5_MB_STEP(MD5_MB_F, b, c, d, a, x[15], 0x49b40821, 22)
+    MD5_MB_STEP(MD5_MB_G, a, b, c, d, x[1], 0xf61e2562, 5)
+    MD5_MB_STEP(MD5_MB_G, d, a, b, c, x[6], 0xc040b340, 9)
+    MD5_MB_STEP(MD5_MB_G, c, d, a, b, x[11], 0x265e5a51, 14)
+    MD5_MB_STEP(MD5_MB_G, b, c, d, a, x[0], 0xe9b6c7aa, 20)
+    MD5_MB_STEP(MD5_MB_G, a, b, c, d, x[5], 0xd62f105d, 5)
+    MD5_MB_STEP(MD5_MB_G, d, a, b, c, x[10], 0x02441453, 9)
+    MD5_MB_STEP(MD5_MB_G, c, d, a, b, x[15], 0xd8a1e681, 14)
+    MD5_MB_STEP(MD5_MB_G, b, c, d, a, x[4], 0xe7d3fbc8, 20)
+    MD5_MB_STEP(MD5_MB_G, a, b, c, d, x[9], 0x21e1cde6, 5)
+    MD5_MB_STEP(MD5_MB_G, d, a, b, c, x[14], 0xc33707d6, 9)
+    MD5_MB_STEP(MD5_MB_G, c, d, a, b, x[3], 0xf4d50d87, 14)
+    MD5_MB_STEP(MD5_MB_G, b, c, d, a, x[8], 0x455a14ed, 20)
+    MD5_MB_STEP(MD5_MB_G, a, b, c, d, x[13], 0xa9e3e905, 5)
+    MD5_MB_STEP(MD5_MB_G, d, a, b, c, x[2], 0xfcefa3f8, 9)
+    MD5_MB_STEP(MD5_MB_G, c, d, a, b, x[7], 0x676f02d9, 14)
+    MD5_MB_STEP(MD5_MB_G, b, c, d, a, x[12], 0x8d2a4c8a, 20)
+    MD5_MB_STEP(MD5_MB_H, a, b, c, d, x[5], 0xfffa3942, 4)
+    MD5_MB_STEP(MD5_MB_H, d, a, b, c, x[8], 0x8771f681, 11)
+    MD5_MB_STEP(MD5_MB_H, c, d, a, b, x[11], 0x6d9d6122, 16)
+    MD5_MB_STEP(MD5_MB_H, b, c, d, a, x[14], 0xfde5380c, 23)
+    MD5_MB_STEP(MD5_MB_H, a, b, c, d, x[1], 0xa4beea44, 4)
+    MD5_MB_STEP(MD5_MB_H, d, a, b, c, x[4], 0x4bdecfa9, 11)
+    MD5_MB_STEP(MD5_MB_H, c, d, a, b, x[7], 0xf6bb4b60, 16)
+    MD5_MB_STEP(MD5_MB_H, b, c, d, a, x[10], 0xbebfbc70, 23)
+    MD5_MB_STEP(MD5_MB_H, a, b, c, d, x[13], 0x289b7ec6, 4)
+    MD5_MB_STEP(MD5_MB_H, d, a, b, c, x[0], 0xeaa127fa, 11)
+    MD5_MB_STEP(MD5_MB_H, c, d, a, b, x[3], 0xd4ef3085, 16)
+    MD5_MB_STEP(MD5_MB_H, b, c, d, a, x[6], 0x04881d05, 23)
+    MD5_MB_STEP(MD5_MB_H, a, b, c, d, x[9], 0xd9d4d039, 4)
+    MD5_MB_STEP(MD5_MB_H, d, a, b, c, x[12], 0xe6db99e5, 11)
+    MD5_MB_STEP(MD5_MB_H, c, d, a, b, x[15], 0x1fa27cf8, 16)
+    MD5_MB_STEP(MD5_MB_H, b, c, d, a, x[2], 0xc4ac5665, 23)
+    MD5_MB_STEP(MD5_MB_I, a, b, c, d, x[0], 0xf4292244, 6)
+    MD5_MB_STEP(MD5_MB_I, d, a, b, c, x[7], 0x432aff97, 10)
+    MD5_MB_STEP(MD5_MB_I, c, d, a, b, x[14], 0xab9423a7, 15)
+    MD5_MB_STEP(MD5_MB_I, b, c, d, a, x[5], 0xfc93a039, 21)
+    MD5_MB_STEP(MD5_MB_I, a, b, c, d, x[12], 0x655b59c3, 6)
+    MD5_MB_STEP(MD5_MB_I, d, a, b, c, x[3], 0x8f0ccc92, 10)
+    MD5_MB_STEP(MD5_MB_I, c, d, a, b, x[10], 0xffeff47d, 15)
+    MD5_MB_STEP(MD5_MB_I, b, c, d, a, x[1], 0x85845dd1, 21)
+    MD5_MB_STEP(MD5_MB_I, a, b, c, d, x[8], 0x6fa87e4f, 6)
+    MD5_MB_STEP(MD5_MB_I, d, a, b, c, x[15], 0xfe2ce6e0, 10)
+    MD5_MB_STEP(MD5_MB_I, c, d, a, b, x[6], 0xa3014314, 15)
+    MD5_MB_STEP(MD5_MB_I, b, c, d, a, x[13], 0x4e0811a1, 21)
+    MD5_MB_STEP(MD5_MB_I, a, b, c, d, x[4], 0xf7537e82, 6)
+    MD5_MB_STEP(MD5_MB_I, d, a, b, c, x[11], 0xbd3af235, 10)
+    MD5_MB_STEP(MD5_MB_I, c, d, a, b, x[2], 0x2ad7d2bb, 15)
+    MD5_MB_STEP(MD5_MB_I, b, c, d, a, x[9], 0xeb86d391, 21)
+
+    a += sa;
+    b += sb;
+    c += sc;
+    d += sd;
+
+    memcpy(state[0], &a, sizeof(V));
+    memcpy(state[1], &b, sizeof(V));
+    memcpy(state[2], &c, sizeof(V));
+    memcpy(state[3], &d, sizeof(V));
+}
+
+#undef MD5_MB_F
+#undef MD5_MB_G
+#undef MD5_MB_H
+#undef MD5_MB_I
+#undef MD5_MB_STEP
+
+/**
+ * @brief      Message of one lane split to full blocks and padded tail blocks.
+ */
+struct Md5LaneInput
+{
+    const uint8_t *data = nullptr; // full 64-byte blocks of the message
+    size_t fullBlocks = 0;         // number of full blocks in data
+    size_t totalBlocks = 0;        // full blocks plus padding blocks
+    uint8_t tail[128];             // last partial block with MD5 padding
+
+    void init(const uint8_t *ptr, size_t len)
+    {
+        data = ptr;
+        fullBlocks = len / 64;
+        size_t rest = len % 64;
+        size_t tailBlocks = rest < 56 ? 1 : 2;
+        totalBlocks = fullBlocks + tailBlocks;
+
+        memset(tail, 0, sizeof(tail));
+        if (rest > 0)
+        {
+            memcpy(tail, ptr + fullBlocks * 64, rest);
+        }
+        tail[rest] = 0x80;
+
+        uint64_t bits = static_cast<uint64_t>(len) << 3;
+        uint8_t *lenPtr = tail + tailBlocks * 64 - 8;
+        for (size_t i = 0; i < 8; ++i)
+        {
+            lenPtr[i] = static_cast<uint8_t>(bits >> (8 * i));
+        }
+    }
+
+    const uint8_t *block(size_t i) const
+    {
+        return i < fullBlocks ? data + i * 64 : tail + (i - fullBlocks) * 64;
+    }
+};
+
+/**
+ * @brief      Hashes count messages using N lanes at a time.
+ *
+ * Lanes run in lockstep for the blocks all messages of a group have in common,
+ * the remaining blocks of longer messages are finished one lane at a time.
+ * Pipeline blocks are all of the same size except the last one, so almost all
+ * of the work goes through the vector path.
+ *
+ * @param[in]  data   Message pointers.
+ * @param[in]  lens   Message lengths.
+ * @param[in]  count  Number of messages.
+ * @param      out    Raw digests, 16 bytes per message.
+ *
+ * @tparam     V      Vector type of N 32-bit words (or uint32_t for N = 1).
+ * @tparam     N      Number of lanes.
+ */
+template <typename V, size_t N>
+void md5MultiLane(const uint8_t *const *data, const size_t *lens, size_t count, uint8_t (*out)[16])
+{
+    static const uint8_t zeroBlock[64] = {};
+
+    for (size_t first = 0; first < count; first += N)
+    {
+        size_t used = count - first < N ? count - first : N;
+        Md5LaneInput lanes[N];
+        uint32_t state[4][N];
+        size_t common = SIZE_MAX;
+
+        for (size_t lane = 0; lane < N; ++lane)
+        {
+            state[0][lane] = 0x67452301;
+            state[1][lane] = 0xefcdab89;
+            state[2][lane] = 0x98badcfe;
+            state[3][lane] = 0x10325476;
+
+            if (lane < used)
+            {
+                lanes[lane].init(data[first + lane], lens[first + lane]);
+                common = lanes[lane].totalBlocks < common ? lanes[lane].totalBlocks : common;
+            }
+        }
+
+        const uint8_t *blocks[N];
+        for (size_t i = 0; i < common; ++i)
+        {
+            for (size_t lane = 0; lane < N; ++lane)
+            {
+                blocks[lane] = lane < used ? lanes[lane].block(i) : zeroBlock;
+            }
+
+            md5Compress<V, N>(state, blocks);
+        }
+
+        for (size_t lane = 0; lane < used; ++lane)
+        {
+            uint32_t single[4][1] = {{state[0][lane]}, {state[1][lane]}, {state[2][lane]}, {state[3][lane]}};
+
+            for (size_t i = common; i < lanes[lane].totalBlocks; ++i)
+            {
+                const uint8_t *const block[1] = {lanes[lane].block(i)};
+                md5Compress<uint32_t, 1>(single, block);
+            }
+
+            uint8_t *digest = out[first + lane];
+            for (size_t word = 0; word < 4; ++word)
+            {
+                for (size_t i = 0; i < 4; ++i)
+                {
+                    digest[word * 4 + i] = static_cast<uint8_t>(single[word][0] >> (8 * i));
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief      Continues MD5 of count messages by the same number of full blocks.
+ *
+ * Used by incremental hashing, states are kept per message between calls and
+ * are loaded to lanes N messages at a time.
+ *
+ * @param      state   The message states, 4 consecutive words per message.
+ * @param[in]  data    Pointers to the blocks of messages.
+ * @param[in]  count   Number of messages.
+ * @param[in]  blocks  Number of 64-byte blocks of every message.
+ *
+ * @tparam     V       Vector type of N 32-bit words (or uint32_t for N = 1).
+ * @tparam     N       Number of lanes.
+ */
+template <typename V, size_t N>
+void md5MultiBlocks(uint32_t *state, const uint8_t *const *data, size_t count, size_t blocks)
+{
+    for (size_t first = 0; first < count; first += N)
+    {
+        size_t used = count - first < N ? count - first : N;
+        uint32_t lanes[4][N] = {};
+        const uint8_t *ptrs[N];
+
+        for (size_t lane = 0; lane < N; ++lane)
+        {
+            // unused lanes repeat blocks of the first message, their result is dropped
+            size_t message = first + (lane < used ? lane : 0);
+            ptrs[lane] = data[message];
+
+            for (size_t word = 0; word < 4; ++word)
+            {
+                lanes[word][lane] = state[message * 4 + word];
+            }
+        }
+
+        for (size_t i = 0; i < blocks; ++i)
+        {
+            const uint8_t *block[N];
+
+            for (size_t lane = 0; lane < N; ++lane)
+            {
+                block[lane] = ptrs[lane] + i * 64;
+            }
+
+            md5Compress<V, N>(lanes, block);
+        }
+
+        for (size_t lane = 0; lane < used; ++lane)
+        {
+            for (size_t word = 0; word < 4; ++word)
+            {
+                state[(first + lane) * 4 + word] = lanes[word][lane];
+            }
+        }
+    }
+}
+
+} // namespace
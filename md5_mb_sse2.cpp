@@ -0,0 +1,17 @@
+#include "md5_mb_kernel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+typedef uint32_t Md5Vec4 __attribute__((vector_size(16)));
+
+void md5MultiSse2(const uint8_t *const *data, const size_t *lens, size_t count, uint8_t (*out)[16])
+{
+    md5MultiLane<Md5Vec4, 4>(data, lens, count, out);
+}
+
+void md5BlocksSse2(uint32_t *state, const uint8_t *const *data, size_t count, size_t blocks)
+{
+    md5MultiBlocks<Md5Vec4, 4>(state, data, count, blocks);
+}
+
+#endif
@@ -0,0 +1,94 @@
+#include "merkle_tree.h"
+
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+static const uint8_t nodePrefix = 0x01; // separates nodes from leaves of two digests
+
+MerkleTree::MerkleTree(HashAlgorithm algorithm, bool keepLevels) :
+    _hash(hashBatchFunc(algorithm)),
+    _keepLevels(keepLevels)
+{
+}
+
+Digest MerkleTree::parent(const Digest &left, const Digest &right) const
+{
+    uint8_t data[1 + 2 * Digest::maxSize];
+    size_t length = 1 + left.size() + right.size();
+    const uint8_t *ptr = data;
+    Digest result;
+
+    data[0] = nodePrefix;
+    memcpy(data + 1, left.data(), left.size());
+    memcpy(data + 1 + left.size(), right.data(), right.size());
+    _hash(&ptr, &length, 1, &result);
+    return result;
+}
+
+void MerkleTree::addNode(size_t level, const Digest &node)
+{
+    if (level == _pending.size())
+    {
+        _pending.emplace_back();
+    }
+
+    if (_keepLevels && level > 0)
+    {
+        if (level > _nodes.size())
+        {
+            _nodes.resize(level);
+        }
+
+        _nodes[level - 1].push_back(node);
+    }
+
+    if (!_pending[level].present)
+    {
+        _pending[level].node = node;
+        _pending[level].present = true;
+        return;
+    }
+
+    _pending[level].present = false;
+    addNode(level + 1, parent(_pending[level].node, node));
+}
+
+void MerkleTree::add(const Digest &leaf)
+{
+    ++_leaves;
+    addNode(0, leaf);
+}
+
+Digest MerkleTree::finish()
+{
+    if (_leaves == 0)
+    {
+        throw logic_error("Merkle tree has no leaves");
+    }
+
+    // the top level holds only the root, odd nodes below are promoted upwards
+    for (size_t level = 0; level + 1 < _pending.size(); ++level)
+    {
+        if (_pending[level].present)
+        {
+            _pending[level].present = false;
+            addNode(level + 1, _pending[level].node);
+        }
+    }
+
+    return _pending.back().node;
+}
+
+vector<uint64_t> MerkleTree::levelSizes(uint64_t leaves)
+{
+    vector<uint64_t> sizes{leaves};
+
+    while (sizes.back() > 1)
+    {
+        sizes.push_back((sizes.back() + 1) / 2);
+    }
+
+    return sizes;
+}
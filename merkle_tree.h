@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "hash_algorithm.h"
+
+/**
+ * @brief      Merkle tree stored in signature.
+ */
+enum class TreeMode
+{
+    None,
+    Root,   // root only
+    Levels  // all levels above leaves
+};
+
+/**
+ * @brief      Merkle tree over block digests built while digests arrive.
+ *
+ * Level 0 holds the block digests. Every next level holds parents of adjacent
+ * pairs, parent digest is H(0x01 || left || right) of the same algorithm, and
+ * the last node of an odd level is promoted to the next level unchanged. This
+ * gives the same shape as splitting at the largest power of two (RFC 6962), and
+ * level k + 1 has ceil(n / 2) nodes of level k with n nodes.
+ *
+ * A parent is hashed as soon as both children are known, so only one pending
+ * node per level is kept unless all levels are requested.
+ */
+class MerkleTree
+{
+public:
+    /**
+     * @brief      Constructs empty tree.
+     *
+     * @param[in]  algorithm   The algorithm of leaves and nodes.
+     * @param[in]  keepLevels  Keep all nodes above leaves for levels().
+     */
+    MerkleTree(HashAlgorithm algorithm, bool keepLevels);
+
+    /**
+     * @brief      Adds the next block digest.
+     *
+     * @param[in]  leaf  The digest.
+     */
+    void add(const Digest &leaf);
+
+    /**
+     * @brief      Completes the tree, must be called once after the last leaf.
+     *
+     * @return     The root, equal to the only leaf of one-leaf tree.
+     *
+     * @throws     std::logic_error if tree has no leaves.
+     */
+    Digest finish();
+
+    /**
+     * @brief      Gets nodes of levels from 1 to the root level, kept only with keepLevels.
+     */
+    const std::vector<std::vector<Digest>> &levels() const
+    {
+        return _nodes;
+    }
+
+    /**
+     * @brief      Calculates number of nodes on every level.
+     *
+     * @param[in]  leaves  The number of leaves.
+     *
+     * @return     Sizes of levels from 0 (leaves) to the root level.
+     */
+    static std::vector<uint64_t> levelSizes(uint64_t leaves);
+private:
+    /**
+     * @brief      Last node of a level waiting for its right sibling.
+     */
+    struct Pending
+    {
+        Digest node;
+        bool present = false;
+    };
+
+    HashBatchFunc _hash;
+    bool _keepLevels;
+    std::vector<Pending> _pending;            // by level
+    std::vector<std::vector<Digest>> _nodes;  // levels above leaves, kept with _keepLevels
+    uint64_t _leaves = 0;
+
+    Digest parent(const Digest &left, const Digest &right) const;
+    void addNode(size_t level, const Digest &node);
+};
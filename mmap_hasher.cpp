@@ -0,0 +1,104 @@
+#include "mmap_hasher.h"
+#include "file_handle.h"
+#include "md5_mb.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace std;
+
+/**
+ * @brief      Mapped part of the input, unmapped when the last block is released.
+ */
+struct MappedWindow
+{
+    void *addr = MAP_FAILED;
+    size_t length = 0;
+    vector<Buffer> blocks; // views of the blocks inside mapping
+
+    ~MappedWindow()
+    {
+        if (addr != MAP_FAILED)
+        {
+            munmap(addr, length);
+        }
+    }
+};
+
+MmapHasher::MmapHasher(size_t blockSize, size_t threads, size_t windowSize) :
+    MultiThreadHasher(blockSize, threads)
+{
+    // window holds whole batches, so every batch lies in a single mapping
+    size_t lanes = md5MultiLanes();
+    size_t batchBytes = max(static_cast<size_t>(1), _size * lanes);
+    _windowBlocks = max(static_cast<size_t>(1), windowSize / batchBytes) * lanes;
+}
+
+void MmapHasher::readBlocks(const string &inputFile)
+{
+    FileHandle file(inputFile);
+    static uint8_t emptyBlock[1];
+    size_t fileSize = file.size();
+    _inputSize = fileSize;
+    SparseMap holes(file.get(), fileSize);
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t blockCount = endBlock(fileSize); // last block may be empty
+    size_t lanes = md5MultiLanes();
+
+    for (size_t first = _firstBlock; first < blockCount && !_exceptOccurred; first += _windowBlocks)
+    {
+        size_t count = min(_windowBlocks, blockCount - first);
+        size_t begin = first * _size;
+        size_t end = min(fileSize, (first + count) * _size);
+        size_t mapBegin = begin / pageSize * pageSize; // mapping offset must be page-aligned
+        auto window = make_shared<MappedWindow>();
+        bool hole = end > begin && holes.isHole(begin, end - begin); // nothing to map
+
+        if (end > begin && !hole)
+        {
+            window->length = end - mapBegin;
+            window->addr = mmap(nullptr, window->length, PROT_READ, MAP_SHARED, file.get(), mapBegin);
+
+            if (window->addr == MAP_FAILED)
+            {
+                throw runtime_error("cannot map file " + inputFile + ": " + strerror(errno));
+            }
+
+            madvise(window->addr, window->length, MADV_SEQUENTIAL);
+            madvise(window->addr, window->length, MADV_WILLNEED); // start read-ahead of the whole window
+        }
+
+        window->blocks.reserve(count);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            size_t offset = (first + i) * _size;
+            size_t length = min(_size, fileSize - min(offset, fileSize));
+            // blocks in holes point to zero pages, so page cache is not filled with zeros
+            bool blockHole = hole || (length == _size && holes.isHole(offset, length));
+            uint8_t *ptr = blockHole ? _zeroBlock.get() :
+                           length > 0 ? static_cast<uint8_t *>(window->addr) + (offset - mapBegin) : emptyBlock;
+
+            window->blocks.emplace_back(ptr, length);
+            window->blocks.back().setSize(length);
+            window->blocks.back().setHole(blockHole);
+        }
+
+        for (size_t i = 0; i < count && !_exceptOccurred; i += lanes)
+        {
+            vector<shared_ptr<Buffer>> batch;
+
+            for (size_t j = i; j < min(count, i + lanes); ++j)
+            {
+                // aliasing pointer keeps the whole window mapped while block is in use
+                batch.push_back(shared_ptr<Buffer>(window, &window->blocks[j]));
+            }
+
+            addHasherTask(move(batch));
+        }
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "block_hasher.h"
+
+#include <string>
+
+/**
+ * @brief      Multi thread hasher reading blocks directly from memory mapped input.
+ *
+ * Input is mapped by windows of several batches, blocks are hashed right from the
+ * mapping without copying and every window is unmapped when all its blocks are
+ * hashed, so address space usage does not depend on file size.
+ */
+class MmapHasher : public MultiThreadHasher
+{
+public:
+    /**
+     * @brief      Constructs the mmap hasher.
+     *
+     * @param[in]  blockSize   The block size in bytes.
+     * @param[in]  threads     The number of hasher threads.
+     * @param[in]  windowSize  The approximate size of one mapped window in bytes.
+     */
+    MmapHasher(size_t blockSize = 1024 * 1024, size_t threads = 4, size_t windowSize = 64 * 1024 * 1024);
+protected:
+    virtual void readBlocks(const std::string &inputFile) override;
+
+    // pages of mapped input are faulted in by the worker hashing them
+    virtual bool workersReadBlocks() const override
+    {
+        return true;
+    }
+private:
+    size_t _windowBlocks; // number of blocks in one mapped window
+};
@@ -0,0 +1,160 @@
+#include "output_file.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+OutputFile::OutputFile(const string &fileName, bool append, size_t flushInterval, size_t bufferSize) :
+    _name(fileName),
+    _buffer(bufferSize > 0 ? bufferSize : 1),
+    _flushInterval(flushInterval)
+{
+    _fd = open(fileName.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (append ? O_APPEND : O_TRUNC), 0644);
+
+    if (_fd < 0)
+    {
+        throw invalid_argument("cannot open file " + fileName);
+    }
+
+    struct stat st;
+    _size = append && fstat(_fd, &st) == 0 ? st.st_size : 0;
+}
+
+OutputFile::OutputFile(const string &fileName, uint64_t keepLength, size_t flushInterval, size_t bufferSize) :
+    _name(fileName),
+    _buffer(bufferSize > 0 ? bufferSize : 1),
+    _flushInterval(flushInterval),
+    _size(keepLength)
+{
+    // no O_APPEND, writeAt() must be able to overwrite data inside the file
+    _fd = open(fileName.c_str(), O_WRONLY | O_CLOEXEC);
+
+    if (_fd < 0)
+    {
+        throw invalid_argument("cannot open file " + fileName);
+    }
+
+    struct stat st;
+
+    if (fstat(_fd, &st) != 0 || static_cast<uint64_t>(st.st_size) < keepLength)
+    {
+        close(_fd);
+        throw runtime_error("file " + fileName + " is shorter than " + to_string(keepLength) + " bytes");
+    }
+
+    if (ftruncate(_fd, keepLength) != 0 || lseek(_fd, keepLength, SEEK_SET) < 0)
+    {
+        int error = errno;
+        close(_fd);
+        throw runtime_error("cannot cut file " + fileName + ": " + strerror(error));
+    }
+}
+
+OutputFile::~OutputFile()
+{
+    try
+    {
+        flush();
+    }
+    catch (...)
+    {
+    }
+
+    close(_fd);
+}
+
+void OutputFile::write(const void *data, size_t length)
+{
+    auto ptr = static_cast<const uint8_t *>(data);
+
+    if (_used + length > _buffer.size())
+    {
+        flush();
+
+        if (length >= _buffer.size()) // too large to buffer
+        {
+            writeAll(ptr, length);
+            return;
+        }
+    }
+
+    memcpy(_buffer.data() + _used, ptr, length);
+    _used += length;
+}
+
+void OutputFile::flush()
+{
+    _records = 0;
+
+    if (_used > 0)
+    {
+        size_t used = _used;
+        _used = 0;
+        writeAll(_buffer.data(), used);
+    }
+}
+
+void OutputFile::writeAt(const void *data, size_t length, uint64_t offset)
+{
+    flush();
+    auto ptr = static_cast<const uint8_t *>(data);
+
+    while (length > 0)
+    {
+        ssize_t count = pwrite(_fd, ptr, length, offset);
+
+        if (count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (count <= 0)
+        {
+            throw runtime_error("cannot write file " + _name + ": " + strerror(errno));
+        }
+
+        ptr += count;
+        length -= count;
+        offset += count;
+    }
+
+    _size = max(_size, offset);
+}
+
+void OutputFile::sync()
+{
+    flush();
+
+    if (fsync(_fd) != 0)
+    {
+        throw runtime_error("cannot sync file " + _name + ": " + strerror(errno));
+    }
+}
+
+void OutputFile::writeAll(const uint8_t *data, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t count = ::write(_fd, data, length);
+
+        if (count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (count <= 0)
+        {
+            throw runtime_error("cannot write file " + _name + ": " + strerror(errno));
+        }
+
+        data += count;
+        length -= count;
+        _size += count;
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief      Buffered output file writing with large write() calls.
+ *
+ * Data is collected in memory and written when the buffer is full, when flush
+ * interval of records is reached, or on flush().
+ */
+class OutputFile
+{
+public:
+    /**
+     * @brief      Opens the file.
+     *
+     * @param[in]  fileName       The file name.
+     * @param[in]  append         Append to existing file, otherwise it is truncated.
+     * @param[in]  flushInterval  Flush after this number of records, 0 to flush only when buffer is full.
+     * @param[in]  bufferSize     The buffer size in bytes.
+     */
+    OutputFile(const std::string &fileName, bool append, size_t flushInterval = 0, size_t bufferSize = 1024 * 1024);
+
+    /**
+     * @brief      Opens existing file cutting it to given length, data is written after it.
+     *
+     * Used to continue a signature of an interrupted run after its last durable record.
+     *
+     * @param[in]  fileName       The file name.
+     * @param[in]  keepLength     The length of data kept, not more than the file size.
+     * @param[in]  flushInterval  Flush after this number of records, 0 to flush only when buffer is full.
+     * @param[in]  bufferSize     The buffer size in bytes.
+     *
+     * @throws     std::runtime_error if file is shorter than keepLength.
+     */
+    OutputFile(const std::string &fileName, uint64_t keepLength, size_t flushInterval,
+               size_t bufferSize = 1024 * 1024);
+
+    /**
+     * @brief      Writes the rest of buffer and closes the file, errors are ignored.
+     */
+    ~OutputFile();
+
+    OutputFile(const OutputFile &) = delete;
+    OutputFile &operator=(const OutputFile &) = delete;
+
+    /**
+     * @brief      Appends data to the buffer.
+     *
+     * @param[in]  data    The data.
+     * @param[in]  length  The length.
+     */
+    void write(const void *data, size_t length);
+
+    /**
+     * @brief      Marks end of a record, buffer is flushed every flushInterval records.
+     */
+    void endRecord()
+    {
+        if (_flushInterval > 0 && ++_records >= _flushInterval)
+        {
+            flush();
+        }
+    }
+
+    /**
+     * @brief      Writes buffered data to the file.
+     */
+    void flush();
+
+    /**
+     * @brief      Flushes buffer and overwrites data at given file offset.
+     *
+     * @param[in]  data    The data.
+     * @param[in]  length  The length.
+     * @param[in]  offset  The file offset.
+     */
+    void writeAt(const void *data, size_t length, uint64_t offset);
+
+    /**
+     * @brief      Flushes buffer and makes file contents durable.
+     */
+    void sync();
+
+    /**
+     * @brief      Gets file size including buffered data.
+     */
+    uint64_t size() const
+    {
+        return _size + _used;
+    }
+
+private:
+    int _fd;
+    std::string _name;
+    std::vector<uint8_t> _buffer; // pending data
+    size_t _used = 0;             // bytes used in _buffer
+    size_t _flushInterval;        // records between flushes
+    size_t _records = 0;          // records since last flush
+    uint64_t _size = 0;           // bytes in the file
+
+    void writeAll(const uint8_t *data, size_t length);
+};
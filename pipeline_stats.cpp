@@ -0,0 +1,171 @@
+#include "pipeline_stats.h"
+
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+using namespace std::chrono;
+
+void LatencyHistogram::record(uint64_t nanoseconds)
+{
+    size_t bucket = nanoseconds > 1 ? 63 - __builtin_clzll(nanoseconds) : 0;
+    _buckets[bucket < bucketCount ? bucket : bucketCount - 1].fetch_add(1, memory_order_relaxed);
+    _count.fetch_add(1, memory_order_relaxed);
+    _total.fetch_add(nanoseconds, memory_order_relaxed);
+
+    uint64_t current = _max.load(memory_order_relaxed);
+
+    while (nanoseconds > current && !_max.compare_exchange_weak(current, nanoseconds, memory_order_relaxed))
+    {
+    }
+}
+
+uint64_t LatencyHistogram::percentile(double fraction) const
+{
+    uint64_t count = this->count();
+    uint64_t seen = 0;
+
+    for (size_t i = 0; i < bucketCount && count > 0; ++i)
+    {
+        seen += _buckets[i].load(memory_order_relaxed);
+
+        if (seen >= fraction * count)
+        {
+            return min(static_cast<uint64_t>(2) << i, max()); // bucket bound never exceeds the maximum
+        }
+    }
+
+    return max();
+}
+
+string LatencyHistogram::toJson() const
+{
+    ostringstream json;
+    uint64_t count = this->count();
+
+    json << fixed << setprecision(3);
+    json << "{\"count\":" << count << ",\"total_ms\":" << total() / 1e6 <<
+         ",\"mean_us\":" << (count > 0 ? total() / 1e3 / count : 0.0) <<
+         ",\"p50_us\":" << percentile(0.5) / 1e3 << ",\"p90_us\":" << percentile(0.9) / 1e3 <<
+         ",\"p99_us\":" << percentile(0.99) / 1e3 << ",\"max_us\":" << max() / 1e3 << ",\"buckets\":[";
+
+    bool first = true;
+
+    for (size_t i = 0; i < bucketCount; ++i)
+    {
+        uint64_t value = _buckets[i].load(memory_order_relaxed);
+
+        if (value > 0)
+        {
+            json << (first ? "" : ",") << "{\"le_us\":" << (static_cast<uint64_t>(2) << i) / 1e3 <<
+                 ",\"count\":" << value << "}";
+            first = false;
+        }
+    }
+
+    json << "]}";
+    return json.str();
+}
+
+PipelineStats::PipelineStats() :
+    _start(steady_clock::now())
+{
+}
+
+double PipelineStats::elapsed() const
+{
+    return duration<double>(steady_clock::now() - _start).count();
+}
+
+const char *PipelineStats::stageName(Stage stage)
+{
+    switch (stage)
+    {
+    case Stage::Read:
+        return "read";
+    case Stage::Hash:
+        return "hash";
+    case Stage::ReaderWait:
+        return "reader_wait";
+    case Stage::BufferWait:
+        return "buffer_wait";
+    case Stage::WriterWait:
+        return "writer_wait";
+    case Stage::Write:
+        return "write";
+    default:
+        return "unknown";
+    }
+}
+
+string PipelineStats::toJson() const
+{
+    ostringstream json;
+    double seconds = elapsed();
+
+    json << fixed << setprecision(3);
+    json << "{\"seconds\":" << seconds << ",\"blocks\":" << blocks() << ",\"bytes\":" << bytes() <<
+         ",\"blocks_per_s\":" << (seconds > 0 ? blocks() / seconds : 0.0) <<
+         ",\"mb_per_s\":" << (seconds > 0 ? bytes() / seconds / 1e6 : 0.0) << ",\"stages\":{";
+
+    for (size_t i = 0; i < _stages.size(); ++i)
+    {
+        json << (i > 0 ? "," : "") << "\"" << stageName(static_cast<Stage>(i)) << "\":" << _stages[i].toJson();
+    }
+
+    json << "}}";
+    return json.str();
+}
+
+ProgressReporter::ProgressReporter(const PipelineStats &stats, uint64_t totalBytes, double interval) :
+    _stats(stats),
+    _totalBytes(totalBytes),
+    _interval(interval > 0 ? interval : 1),
+    _thread(&ProgressReporter::run, this)
+{
+}
+
+ProgressReporter::~ProgressReporter()
+{
+    {
+        lock_guard<mutex> lock(_m);
+        _stop = true;
+    }
+
+    _stopCv.notify_one();
+    _thread.join();
+}
+
+void ProgressReporter::run()
+{
+    unique_lock<mutex> lock(_m);
+
+    while (!_stopCv.wait_for(lock, _interval, [this]() { return _stop; }))
+    {
+        print();
+    }
+
+    print(); // final state
+    fputc('\n', stderr);
+}
+
+void ProgressReporter::print() const
+{
+    double seconds = _stats.elapsed();
+    double mb = _stats.bytes() / 1e6;
+
+    if (_totalBytes > 0)
+    {
+        fprintf(stderr, "\rHashed %.0f of %.0f MB (%.1f%%), %llu blocks, %.1f MB/s ", mb, _totalBytes / 1e6,
+                100.0 * _stats.bytes() / _totalBytes, static_cast<unsigned long long>(_stats.blocks()),
+                seconds > 0 ? mb / seconds : 0.0);
+    }
+    else
+    {
+        fprintf(stderr, "\rHashed %.0f MB, %llu blocks, %.1f MB/s ", mb,
+                static_cast<unsigned long long>(_stats.blocks()), seconds > 0 ? mb / seconds : 0.0);
+    }
+
+    fflush(stderr);
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * @brief      Stages of hashing pipeline measured by PipelineStats.
+ */
+enum class Stage
+{
+    Read,        // reading input: read(), pread() or waiting for io_uring completions
+    Hash,        // hashing a batch of blocks, includes page faults of mapped input
+    ReaderWait,  // reader waits for a free slot of the completion ring (back-pressure)
+    BufferWait,  // waiting for a free buffer of the pool
+    WriterWait,  // writer waits for digests of the next batch
+    Write,       // writing digests of a batch to the signature
+    Count
+};
+
+/**
+ * @brief      Latency histogram with power of two buckets of nanoseconds.
+ *
+ * Recording is a few relaxed atomic additions, so it can be updated by all
+ * threads without locking.
+ */
+class LatencyHistogram
+{
+public:
+    static const size_t bucketCount = 48; // bucket i counts latencies below 2^(i + 1) ns
+
+    /**
+     * @brief      Records one latency.
+     *
+     * @param[in]  nanoseconds  The latency.
+     */
+    void record(uint64_t nanoseconds);
+
+    uint64_t count() const
+    {
+        return _count.load(std::memory_order_relaxed);
+    }
+
+    uint64_t total() const
+    {
+        return _total.load(std::memory_order_relaxed);
+    }
+
+    uint64_t max() const
+    {
+        return _max.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief      Estimates percentile by upper bound of its bucket.
+     *
+     * @param[in]  fraction  The percentile from 0 to 1.
+     *
+     * @return     Latency in nanoseconds, 0 if nothing is recorded.
+     */
+    uint64_t percentile(double fraction) const;
+
+    /**
+     * @brief      Serializes count, total, mean, percentiles and non-empty buckets in microseconds.
+     */
+    std::string toJson() const;
+private:
+    std::array<std::atomic<uint64_t>, bucketCount> _buckets{};
+    std::atomic<uint64_t> _count{0};
+    std::atomic<uint64_t> _total{0}; // nanoseconds
+    std::atomic<uint64_t> _max{0};
+};
+
+/**
+ * @brief      Counters and latency histograms of all pipeline stages.
+ */
+class PipelineStats
+{
+public:
+    PipelineStats();
+
+    /**
+     * @brief      Records time spent in stage.
+     */
+    void record(Stage stage, uint64_t nanoseconds)
+    {
+        _stages[static_cast<size_t>(stage)].record(nanoseconds);
+    }
+
+    /**
+     * @brief      Counts hashed blocks, including ones in holes that are not read.
+     *
+     * @param[in]  blocks  The number of blocks.
+     * @param[in]  bytes   Their total size.
+     */
+    void addBlocks(uint64_t blocks, uint64_t bytes)
+    {
+        _blocks.fetch_add(blocks, std::memory_order_relaxed);
+        _bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    uint64_t blocks() const
+    {
+        return _blocks.load(std::memory_order_relaxed);
+    }
+
+    uint64_t bytes() const
+    {
+        return _bytes.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief      Gets seconds since construction.
+     */
+    double elapsed() const;
+
+    /**
+     * @brief      Serializes totals, rates and histograms of all stages.
+     */
+    std::string toJson() const;
+
+    /**
+     * @brief      Gets stage name used in JSON.
+     */
+    static const char *stageName(Stage stage);
+private:
+    std::array<LatencyHistogram, static_cast<size_t>(Stage::Count)> _stages;
+    std::atomic<uint64_t> _blocks{0};
+    std::atomic<uint64_t> _bytes{0};
+    std::chrono::steady_clock::time_point _start;
+};
+
+/**
+ * @brief      Measures scope duration and records it to stage, does nothing without stats.
+ */
+class StageTimer
+{
+public:
+    StageTimer(PipelineStats *stats, Stage stage) :
+        _stats(stats),
+        _stage(stage)
+    {
+        if (_stats != nullptr)
+        {
+            _start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~StageTimer()
+    {
+        if (_stats != nullptr)
+        {
+            auto duration = std::chrono::steady_clock::now() - _start;
+            _stats->record(_stage, std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+        }
+    }
+
+    StageTimer(const StageTimer &) = delete;
+    StageTimer &operator=(const StageTimer &) = delete;
+private:
+    PipelineStats *_stats;
+    Stage _stage;
+    std::chrono::steady_clock::time_point _start;
+};
+
+/**
+ * @brief      Prints progress line to standard error periodically while alive.
+ */
+class ProgressReporter
+{
+public:
+    /**
+     * @brief      Starts reporting.
+     *
+     * @param[in]  stats       The statistics of the run.
+     * @param[in]  totalBytes  The input size, 0 if unknown.
+     * @param[in]  interval    Seconds between lines.
+     */
+    ProgressReporter(const PipelineStats &stats, uint64_t totalBytes, double interval);
+    ~ProgressReporter();
+
+    ProgressReporter(const ProgressReporter &) = delete;
+    ProgressReporter &operator=(const ProgressReporter &) = delete;
+private:
+    const PipelineStats &_stats;
+    uint64_t _totalBytes;
+    std::chrono::duration<double> _interval;
+    std::mutex _m;
+    std::condition_variable _stopCv;
+    bool _stop = false;
+    std::thread _thread;
+
+    void run();
+    void print() const;
+};
@@ -0,0 +1,67 @@
+#include "pread_hasher.h"
+#include "file_handle.h"
+#include "md5_mb.h"
+
+#include <algorithm>
+
+using namespace std;
+
+PreadHasher::PreadHasher(size_t blockSize, size_t threads, bool hugePages) :
+    MultiThreadHasher(blockSize, threads, hugePages)
+{
+}
+
+void PreadHasher::readBlocks(const string &inputFile)
+{
+    // file is shared by tasks which can outlive this method
+    auto file = make_shared<FileHandle>(inputFile);
+    size_t fileSize = file->size();
+    _inputSize = fileSize;
+    SparseMap holes(file->get(), fileSize); // holes are found in main thread, tasks only skip them
+    size_t blockCount = endBlock(fileSize); // last block may be empty
+    size_t lanes = md5MultiLanes();
+
+    for (size_t first = _firstBlock; first < blockCount && !_exceptOccurred; first += lanes)
+    {
+        size_t count = min(lanes, blockCount - first);
+        uint64_t holeMask = 0; // bit per block of the batch
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            size_t offset = (first + i) * _size;
+
+            if (holes.isHole(offset, min(_size, fileSize - min(offset, fileSize))))
+            {
+                holeMask |= static_cast<uint64_t>(1) << i;
+            }
+        }
+
+        addHasherTask([this, file, fileSize, first, count, holeMask]()
+        {
+            vector<shared_ptr<Buffer>> batch;
+
+            for (size_t i = first; i < first + count; ++i)
+            {
+                size_t offset = i * _size;
+                size_t length = min(_size, fileSize - min(offset, fileSize));
+
+                if (holeMask & (static_cast<uint64_t>(1) << (i - first)))
+                {
+                    batch.push_back(holeBlock(length));
+                    continue;
+                }
+
+                auto buffer = acquireBuffer();
+                buffer->setSize(length);
+                {
+                    StageTimer timer(_stats.get(), Stage::Read);
+                    file->readAt(buffer->get(), length, offset);
+                }
+
+                batch.push_back(move(buffer));
+            }
+
+            return hashBlocks(batch);
+        });
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "block_hasher.h"
+
+#include <string>
+
+/**
+ * @brief      Multi thread hasher where every thread reads its own blocks.
+ *
+ * Main thread only assigns batches of block indexes, a hasher thread reads the
+ * batch with positional read at blockIndex * blockSize and hashes it, so reading
+ * scales together with hashing.
+ */
+class PreadHasher : public MultiThreadHasher
+{
+public:
+    /**
+     * @brief      Constructs the positional read hasher.
+     *
+     * @param[in]  blockSize  The block size in bytes.
+     * @param[in]  threads    The number of hasher threads.
+     * @param[in]  hugePages  Back block buffers with huge pages.
+     */
+    PreadHasher(size_t blockSize = 1024 * 1024, size_t threads = 4, bool hugePages = false);
+protected:
+    virtual void readBlocks(const std::string &inputFile) override;
+
+    // every worker reads its own blocks
+    virtual bool workersReadBlocks() const override
+    {
+        return true;
+    }
+
+    // workers read blocks in any order
+    virtual bool supportsFileDigest() const override
+    {
+        return false;
+    }
+};
@@ -0,0 +1,185 @@
+#include "sha256.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+typedef void (*Sha256BlocksFunc)(uint32_t state[8], const uint8_t *blocks, size_t count);
+
+#if defined(__x86_64__) || defined(__i386__)
+// implemented in translation unit compiled with -msha -msse4.1
+void sha256BlocksShaNi(uint32_t state[8], const uint8_t *blocks, size_t count);
+#endif
+
+static const uint32_t sha256K[64] =
+{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static inline uint32_t sha256Rotr(uint32_t x, int s)
+{
+    return (x >> s) | (x << (32 - s));
+}
+
+static void sha256BlocksPortable(uint32_t state[8], const uint8_t *blocks, size_t count)
+{
+    for (; count > 0; --count, blocks += 64)
+    {
+        uint32_t w[64];
+
+        for (int i = 0; i < 16; ++i)
+        {
+            const uint8_t *p = blocks + 4 * i;
+            w[i] = static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16 |
+                   static_cast<uint32_t>(p[2]) << 8 | static_cast<uint32_t>(p[3]);
+        }
+
+        for (int i = 16; i < 64; ++i)
+        {
+            uint32_t s0 = sha256Rotr(w[i - 15], 7) ^ sha256Rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = sha256Rotr(w[i - 2], 17) ^ sha256Rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+        for (int i = 0; i < 64; ++i)
+        {
+            uint32_t s1 = sha256Rotr(e, 6) ^ sha256Rotr(e, 11) ^ sha256Rotr(e, 25);
+            uint32_t t1 = h + s1 + ((e & f) ^ (~e & g)) + sha256K[i] + w[i];
+            uint32_t s0 = sha256Rotr(a, 2) ^ sha256Rotr(a, 13) ^ sha256Rotr(a, 22);
+            uint32_t t2 = s0 + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+static Sha256BlocksFunc selectSha256()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+
+    // SHA extensions have no __builtin_cpu_supports() name in older compilers, so CPUID is read directly
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    bool sha = __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_SHA) != 0;
+
+    if (sha && __builtin_cpu_supports("sse4.1"))
+    {
+        return sha256BlocksShaNi;
+    }
+#endif
+    return sha256BlocksPortable;
+}
+
+static Sha256BlocksFunc sha256Blocks()
+{
+    static const Sha256BlocksFunc blocksFunc = selectSha256();
+    return blocksFunc;
+}
+
+static const uint32_t sha256Iv[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                     0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+/**
+ * @brief      Hashes the last partial block with padding and stores the big-endian digest.
+ */
+static void sha256Finish(uint32_t state[8], const uint8_t *rest, size_t restLen, uint64_t len, uint8_t out[32])
+{
+    // padding: 0x80, zeros and big-endian bit length, one or two blocks
+    uint8_t tail[128] = {};
+    size_t tailSize = restLen < 56 ? 64 : 128;
+    uint64_t bits = len * 8;
+
+    memcpy(tail, rest, restLen);
+    tail[restLen] = 0x80;
+
+    for (int i = 0; i < 8; ++i)
+    {
+        tail[tailSize - 1 - i] = static_cast<uint8_t>(bits >> (8 * i));
+    }
+
+    sha256Blocks()(state, tail, tailSize / 64);
+
+    for (int i = 0; i < 8; ++i)
+    {
+        out[4 * i] = static_cast<uint8_t>(state[i] >> 24);
+        out[4 * i + 1] = static_cast<uint8_t>(state[i] >> 16);
+        out[4 * i + 2] = static_cast<uint8_t>(state[i] >> 8);
+        out[4 * i + 3] = static_cast<uint8_t>(state[i]);
+    }
+}
+
+void sha256(const void *data, size_t len, uint8_t out[32])
+{
+    uint32_t state[8];
+    auto bytes = static_cast<const uint8_t *>(data);
+    size_t full = len / 64;
+
+    memcpy(state, sha256Iv, sizeof(state));
+    sha256Blocks()(state, bytes, full);
+    sha256Finish(state, bytes + full * 64, len - full * 64, len, out);
+}
+
+Sha256Stream::Sha256Stream()
+{
+    memcpy(_state, sha256Iv, sizeof(_state));
+}
+
+void Sha256Stream::update(const void *data, size_t len)
+{
+    auto bytes = static_cast<const uint8_t *>(data);
+    _length += len;
+
+    if (_buffered > 0)
+    {
+        size_t take = len < 64 - _buffered ? len : 64 - _buffered;
+        memcpy(_buffer + _buffered, bytes, take);
+        _buffered += take;
+        bytes += take;
+        len -= take;
+
+        if (_buffered < 64)
+        {
+            return;
+        }
+
+        sha256Blocks()(_state, _buffer, 1);
+        _buffered = 0;
+    }
+
+    size_t full = len / 64;
+    sha256Blocks()(_state, bytes, full);
+    _buffered = len - full * 64;
+    memcpy(_buffer, bytes + full * 64, _buffered);
+}
+
+void Sha256Stream::finish(uint8_t out[32])
+{
+    sha256Finish(_state, _buffer, _buffered, _length, out);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief      Calculates SHA-256 digest.
+ *
+ * SHA extensions are used when supported by the CPU, portable code otherwise.
+ *
+ * @param[in]  data  The data.
+ * @param[in]  len   The data length in bytes.
+ * @param      out   The raw digest, 32 bytes.
+ */
+void sha256(const void *data, size_t len, uint8_t out[32]);
+
+/**
+ * @brief      SHA-256 of data fed by parts, digest is the same as sha256() of their concatenation.
+ */
+class Sha256Stream
+{
+public:
+    Sha256Stream();
+
+    /**
+     * @brief      Hashes the next part of data.
+     *
+     * @param[in]  data  The data.
+     * @param[in]  len   The data length in bytes.
+     */
+    void update(const void *data, size_t len);
+
+    /**
+     * @brief      Pads the data and gets the digest.
+     *
+     * @param      out   The raw digest, 32 bytes.
+     */
+    void finish(uint8_t out[32]);
+private:
+    uint32_t _state[8];
+    uint8_t _buffer[64]; // partial block
+    size_t _buffered = 0;
+    uint64_t _length = 0; // bytes hashed so far
+};
@@ -0,0 +1,177 @@
+#include "shard.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ * @brief      Gets number of blocks of input, the last one may be empty.
+ */
+static uint64_t blockCount(uint64_t inputSize, size_t blockSize)
+{
+    return blockSize > 0 ? inputSize / blockSize + 1 : 1;
+}
+
+ShardRange shardBlocks(uint64_t inputSize, size_t blockSize, size_t index, size_t count)
+{
+    if (count == 0 || index == 0 || index > count)
+    {
+        throw invalid_argument("shard " + to_string(index) + " of " + to_string(count) + " does not exist");
+    }
+
+    uint64_t blocks = blockCount(inputSize, blockSize);
+    ShardRange range;
+    range.first = blocks * (index - 1) / count;
+
+    if (index < count)
+    {
+        range.count = blocks * index / count - range.first;
+    }
+
+    return range;
+}
+
+ShardRange byteBlocks(uint64_t inputSize, size_t blockSize, uint64_t offset, uint64_t length)
+{
+    if (blockSize == 0 || offset % blockSize != 0)
+    {
+        throw invalid_argument("range offset " + to_string(offset) + " is not a multiple of block size");
+    }
+
+    if (offset > inputSize)
+    {
+        throw invalid_argument("range offset " + to_string(offset) + " is after the input end");
+    }
+
+    ShardRange range;
+    range.first = offset / blockSize;
+
+    if (length < inputSize - offset)
+    {
+        if (length % blockSize != 0)
+        {
+            throw invalid_argument("range length " + to_string(length) + " is not a multiple of block size");
+        }
+
+        range.count = length / blockSize;
+    }
+
+    return range;
+}
+
+void parseShard(const string &text, size_t &index, size_t &count)
+{
+    size_t slash = text.find('/');
+    size_t indexEnd = 0, countEnd = 0;
+
+    try
+    {
+        index = stoull(text.substr(0, slash), &indexEnd);
+        count = slash != string::npos ? stoull(text.substr(slash + 1), &countEnd) : 0;
+    }
+    catch (...)
+    {
+        throw invalid_argument("shard " + text + " is not <index>/<count>");
+    }
+
+    if (slash == string::npos || indexEnd != slash || countEnd != text.size() - slash - 1)
+    {
+        throw invalid_argument("shard " + text + " is not <index>/<count>");
+    }
+
+    shardBlocks(0, 1, index, count); // checks index
+}
+
+SignatureHeader mergeShards(const vector<string> &shards, const string &outputFile, SignatureFormat format,
+                            TreeMode tree)
+{
+    if (shards.empty())
+    {
+        throw invalid_argument("no shards to merge");
+    }
+
+    vector<unique_ptr<SignatureFile>> files;
+
+    for (const auto &name : shards)
+    {
+        files.push_back(make_unique<SignatureFile>(name));
+        const SignatureHeader &header = files.back()->header();
+
+        if (!(header.flags & SignatureHeader::shard))
+        {
+            throw runtime_error("signature " + name + " is not a shard");
+        }
+
+        const SignatureHeader &first = files.front()->header();
+
+        if (header.algorithm != first.algorithm || header.blockSize != first.blockSize ||
+                header.inputSize != first.inputSize)
+        {
+            throw runtime_error("shard " + name + " differs from " + shards.front() +
+                                " in algorithm, block size or input size");
+        }
+    }
+
+    vector<size_t> order(files.size());
+
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        order[i] = i;
+    }
+
+    // empty shards go before the shard starting at the same block
+    sort(order.begin(), order.end(), [&files](size_t a, size_t b)
+    {
+        const SignatureHeader &x = files[a]->header(), &y = files[b]->header();
+        return x.firstBlock != y.firstBlock ? x.firstBlock < y.firstBlock : x.blockCount < y.blockCount;
+    });
+
+    // shards must follow each other without gaps and overlaps up to the last block
+    SignatureHeader merged = files.front()->header();
+    uint64_t next = 0;
+
+    for (size_t i : order)
+    {
+        const SignatureHeader &header = files[i]->header();
+
+        if (header.firstBlock != next)
+        {
+            throw runtime_error(string(header.firstBlock > next ? "blocks are missing" : "blocks are repeated") +
+                                " before shard " + shards[i] + " starting at block " + to_string(header.firstBlock) +
+                                ", expected block " + to_string(next));
+        }
+
+        next += header.blockCount;
+    }
+
+    uint64_t expected = blockCount(merged.inputSize, merged.blockSize);
+
+    if (next != expected)
+    {
+        throw runtime_error("shards cover " + to_string(next) + " blocks of " + to_string(expected));
+    }
+
+    auto algorithm = static_cast<HashAlgorithm>(merged.algorithm);
+    auto output = SignatureWriter::create(outputFile, format, algorithm, merged.blockSize, false, 0, tree);
+    Digest digest(merged.digestSize);
+
+    for (size_t i : order)
+    {
+        for (uint64_t block = 0; block < files[i]->blockCount(); ++block)
+        {
+            memcpy(digest.data(), files[i]->digest(block), digest.size());
+            output->write(digest);
+        }
+    }
+
+    output->finish(merged.inputSize);
+
+    merged.flags = tree == TreeMode::Levels ? SignatureHeader::treeRoot | SignatureHeader::treeLevels :
+                   tree == TreeMode::Root ? SignatureHeader::treeRoot : 0;
+    merged.firstBlock = 0;
+    merged.blockCount = next;
+    return merged;
+}
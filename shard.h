@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "merkle_tree.h"
+#include "signature.h"
+
+/**
+ * @brief      Range of blocks hashed by one shard of a run.
+ */
+struct ShardRange
+{
+    static const uint64_t toEnd = UINT64_MAX; // count of range reaching the input end
+
+    uint64_t first = 0;     // index of the first block
+    uint64_t count = toEnd; // number of blocks
+};
+
+/**
+ * @brief      Gets blocks of shard index of count shards splitting input evenly.
+ *
+ * The last shard includes the last block, which is empty when input size is a
+ * multiple of block size.
+ *
+ * @param[in]  inputSize  The input size in bytes.
+ * @param[in]  blockSize  The block size in bytes.
+ * @param[in]  index      The shard index from 1 to count.
+ * @param[in]  count      The number of shards.
+ *
+ * @return     The range, empty when there are less blocks than shards.
+ *
+ * @throws     std::invalid_argument if index is out of range.
+ */
+ShardRange shardBlocks(uint64_t inputSize, size_t blockSize, size_t index, size_t count);
+
+/**
+ * @brief      Gets blocks of byte range of input.
+ *
+ * @param[in]  inputSize  The input size in bytes.
+ * @param[in]  blockSize  The block size in bytes.
+ * @param[in]  offset     The range offset, multiple of block size.
+ * @param[in]  length     The range length, multiple of block size unless the range reaches the input end.
+ *
+ * @return     The range, range reaching the input end includes the last block.
+ *
+ * @throws     std::invalid_argument if range is not aligned to blocks or starts after the input end.
+ */
+ShardRange byteBlocks(uint64_t inputSize, size_t blockSize, uint64_t offset, uint64_t length);
+
+/**
+ * @brief      Parses shard given as "<index>/<count>", like "2/8".
+ *
+ * @param[in]  text   The text.
+ * @param      index  The shard index from 1 to count.
+ * @param      count  The number of shards.
+ *
+ * @throws     std::invalid_argument for malformed text or index out of range.
+ */
+void parseShard(const std::string &text, size_t &index, size_t &count);
+
+/**
+ * @brief      Merges shard signatures of one input into the signature of the whole input.
+ *
+ * Shards may be given in any order and format. They must have the same
+ * algorithm, block size and input size and together cover all blocks of the
+ * input exactly once. Merkle tree is built over the digests of all shards, so
+ * the result is identical to the signature written by a single run.
+ *
+ * @param[in]  shards      The shard signatures.
+ * @param[in]  outputFile  The output signature, overwritten.
+ * @param[in]  format      The output format.
+ * @param[in]  tree        The Merkle tree to store.
+ *
+ * @return     Header of the merged signature.
+ *
+ * @throws     std::runtime_error if shards do not match or do not cover the input.
+ */
+SignatureHeader mergeShards(const std::vector<std::string> &shards, const std::string &outputFile,
+                            SignatureFormat format, TreeMode tree);
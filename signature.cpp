@@ -0,0 +1,845 @@
+#include "signature.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const uint8_t signatureMagic[8] = {'B', 'L', 'K', 'H', 'A', 'S', 'H', '\n'};
+
+static void putLe(uint8_t *out, uint64_t value, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; ++i)
+    {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+static uint64_t getLe(const uint8_t *in, size_t bytes)
+{
+    uint64_t value = 0;
+
+    for (size_t i = 0; i < bytes; ++i)
+    {
+        value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+
+    return value;
+}
+
+static int hexValue(char c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+
+    return -1;
+}
+
+SignatureFormat parseSignatureFormat(const string &name)
+{
+    if (name == "text")
+    {
+        return SignatureFormat::Text;
+    }
+
+    if (name == "binary")
+    {
+        return SignatureFormat::Binary;
+    }
+
+    throw invalid_argument("unknown signature format " + name);
+}
+
+void SignatureHeader::serialize(uint8_t *out) const
+{
+    memset(out, 0, size);
+    memcpy(out, signatureMagic, sizeof(signatureMagic));
+    putLe(out + 8, version, 4);
+    putLe(out + 12, algorithm, 4);
+    putLe(out + 16, digestSize, 4);
+    putLe(out + 20, flags, 4);
+    putLe(out + 24, blockSize, 8);
+    putLe(out + 32, inputSize, 8);
+    putLe(out + 40, blockCount, 8);
+    putLe(out + 48, firstBlock, 8);
+}
+
+bool SignatureHeader::matches(const uint8_t *data, size_t length)
+{
+    return length >= sizeof(signatureMagic) && memcmp(data, signatureMagic, sizeof(signatureMagic)) == 0;
+}
+
+SignatureHeader SignatureHeader::parse(const uint8_t *data, size_t length)
+{
+    if (length < size || !matches(data, length))
+    {
+        throw runtime_error("not a binary signature");
+    }
+
+    SignatureHeader header;
+    header.version = getLe(data + 8, 4);
+    header.algorithm = getLe(data + 12, 4);
+    header.digestSize = getLe(data + 16, 4);
+    header.flags = getLe(data + 20, 4);
+    header.blockSize = getLe(data + 24, 8);
+    header.inputSize = getLe(data + 32, 8);
+    header.blockCount = getLe(data + 40, 8);
+    header.firstBlock = getLe(data + 48, 8);
+
+    if (header.version != currentVersion)
+    {
+        throw runtime_error("unsupported signature version " + to_string(header.version));
+    }
+
+    if (header.digestSize == 0 || (length - size) / header.digestSize < header.blockCount)
+    {
+        throw runtime_error("truncated binary signature");
+    }
+
+    return header;
+}
+
+shared_ptr<SignatureWriter> SignatureWriter::create(const string &outputFile, SignatureFormat format,
+                                                    HashAlgorithm algorithm, size_t blockSize,
+                                                    bool append, size_t flushInterval, TreeMode tree)
+{
+    shared_ptr<SignatureWriter> writer;
+
+    if (format == SignatureFormat::Binary)
+    {
+        writer = make_shared<BinarySignatureWriter>(outputFile, algorithm, blockSize, flushInterval);
+    }
+    else
+    {
+        // tree describes digests of one run only
+        writer = make_shared<TextSignatureWriter>(outputFile, algorithm, append && tree == TreeMode::None,
+                                                  flushInterval);
+    }
+
+    writer->enableTree(algorithm, tree);
+    return writer;
+}
+
+/**
+ * @brief      Checks kept part of signature of an interrupted run and passes its digests to receiver.
+ *
+ * @throws     std::runtime_error if the part is not point.blockCount digests of the algorithm.
+ */
+static void readKeptDigests(const string &outputFile, SignatureFormat format, HashAlgorithm algorithm,
+                            size_t blockSize, const ResumePoint &point, const function<void(const Digest &)> &receiver)
+{
+    if (point.outputSize == 0)
+    {
+        if (point.blockCount > 0)
+        {
+            throw runtime_error("signature " + outputFile + " does not match checkpoint");
+        }
+
+        return;
+    }
+
+    int fd = open(outputFile.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+
+    if (fd < 0 || fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) < point.outputSize)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+
+        throw runtime_error("signature " + outputFile + " is shorter than checkpoint");
+    }
+
+    void *mapping = mmap(nullptr, point.outputSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED)
+    {
+        throw runtime_error("cannot map file " + outputFile + ": " + strerror(errno));
+    }
+
+    unique_ptr<void, function<void(void *)>> unmap(mapping, [&point](void *p) { munmap(p, point.outputSize); });
+    auto data = static_cast<const uint8_t *>(mapping);
+    size_t digestSize = hashDigestSize(algorithm);
+    Digest digest(digestSize);
+    bool matches;
+
+    if (format == SignatureFormat::Binary)
+    {
+        SignatureHeader header = SignatureHeader::parse(data, point.outputSize);
+        matches = header.algorithm == static_cast<uint32_t>(algorithm) && header.blockSize == blockSize &&
+                  (point.outputSize - SignatureHeader::size) / digestSize == point.blockCount &&
+                  (point.outputSize - SignatureHeader::size) % digestSize == 0;
+
+        for (uint64_t i = 0; matches && i < point.blockCount; ++i)
+        {
+            memcpy(digest.data(), data + SignatureHeader::size + i * digestSize, digestSize);
+            receiver(digest);
+        }
+    }
+    else
+    {
+        // optional algorithm line and digest lines of fixed length, the last one complete
+        string header = algorithm != HashAlgorithm::Md5 ? string("# ") + hashAlgorithmName(algorithm) + "\n" : "";
+        size_t lineSize = 2 * digestSize + 1;
+        uint64_t digestBytes = point.outputSize - min<uint64_t>(point.outputSize, header.size());
+        matches = point.outputSize >= header.size() && memcmp(data, header.data(), header.size()) == 0 &&
+                  digestBytes == point.blockCount * lineSize;
+
+        for (uint64_t i = 0; matches && i < point.blockCount; ++i)
+        {
+            auto line = reinterpret_cast<const char *>(data + header.size() + i * lineSize);
+            matches = line[lineSize - 1] == '\n';
+
+            for (size_t j = 0; matches && j < digestSize; ++j)
+            {
+                int high = hexValue(line[2 * j]), low = hexValue(line[2 * j + 1]);
+                matches = high >= 0 && low >= 0;
+                digest.data()[j] = static_cast<uint8_t>(high << 4 | low);
+            }
+
+            if (matches)
+            {
+                receiver(digest);
+            }
+        }
+    }
+
+    if (!matches)
+    {
+        throw runtime_error("signature " + outputFile + " does not match checkpoint");
+    }
+}
+
+shared_ptr<SignatureWriter> SignatureWriter::resume(const string &outputFile, SignatureFormat format,
+                                                    HashAlgorithm algorithm, size_t blockSize,
+                                                    const ResumePoint &point, size_t flushInterval, TreeMode tree)
+{
+    // tree of the whole signature is rebuilt from kept digests before the part after them is cut off
+    auto nodes = tree != TreeMode::None ? make_unique<MerkleTree>(algorithm, tree == TreeMode::Levels) : nullptr;
+    readKeptDigests(outputFile, format, algorithm, blockSize, point, [&nodes](const Digest &digest)
+    {
+        if (nodes)
+        {
+            nodes->add(digest);
+        }
+    });
+
+    shared_ptr<SignatureWriter> writer;
+
+    if (format == SignatureFormat::Binary)
+    {
+        writer = make_shared<BinarySignatureWriter>(outputFile, algorithm, blockSize, point, flushInterval);
+    }
+    else
+    {
+        writer = make_shared<TextSignatureWriter>(outputFile, algorithm, point, flushInterval);
+    }
+
+    writer->_treeMode = tree;
+    writer->_tree = move(nodes);
+    return writer;
+}
+
+TextSignatureWriter::TextSignatureWriter(const string &outputFile, HashAlgorithm algorithm, bool append,
+                                         size_t flushInterval) :
+    _output(outputFile, append, flushInterval)
+{
+    if (algorithm != HashAlgorithm::Md5) // plain MD5 signature stays compatible with older readers
+    {
+        string line = string("# ") + hashAlgorithmName(algorithm) + "\n";
+        _output.write(line.data(), line.size());
+    }
+}
+
+TextSignatureWriter::TextSignatureWriter(const string &outputFile, HashAlgorithm algorithm, const ResumePoint &point,
+                                         size_t flushInterval) :
+    _output(outputFile, point.outputSize, flushInterval)
+{
+    if (point.outputSize == 0 && algorithm != HashAlgorithm::Md5) // nothing was kept
+    {
+        string line = string("# ") + hashAlgorithmName(algorithm) + "\n";
+        _output.write(line.data(), line.size());
+    }
+}
+
+void TextSignatureWriter::write(const Digest &digest)
+{
+    if (_tree)
+    {
+        _tree->add(digest);
+    }
+
+    writeLine(digest);
+    _output.endRecord();
+}
+
+void TextSignatureWriter::writeLine(const Digest &digest)
+{
+    char line[2 * Digest::maxSize + 1];
+    size_t length = digest.toHex(line);
+
+    line[length] = '\n';
+    _output.write(line, length + 1);
+}
+
+void TextSignatureWriter::finish(uint64_t)
+{
+    if (_tree)
+    {
+        Digest root = _tree->finish();
+        const auto &levels = _tree->levels();
+
+        // the last level holds only the root
+        for (size_t level = 0; level + 1 < levels.size(); ++level)
+        {
+            string line = "# level " + to_string(level + 1) + "\n";
+            _output.write(line.data(), line.size());
+
+            for (const auto &node : levels[level])
+            {
+                writeLine(node);
+            }
+        }
+
+        _output.write("# root ", 7);
+        writeLine(root);
+    }
+
+    if (_fileDigest.size() > 0)
+    {
+        _output.write("# file md5 ", 11);
+        writeLine(_fileDigest);
+    }
+
+    if (_shard)
+    {
+        string line = "# shard " + to_string(_shardFirst) + " " + to_string(_shardBlockSize) + " " +
+                      to_string(_shardInputSize) + "\n";
+        _output.write(line.data(), line.size());
+    }
+
+    _output.flush();
+}
+
+uint64_t TextSignatureWriter::sync()
+{
+    _output.sync();
+    return _output.size();
+}
+
+BinarySignatureWriter::BinarySignatureWriter(const string &outputFile, HashAlgorithm algorithm, size_t blockSize,
+                                             size_t flushInterval) :
+    _output(outputFile, false, flushInterval)
+{
+    uint8_t header[SignatureHeader::size];
+
+    _header.algorithm = static_cast<uint32_t>(algorithm);
+    _header.digestSize = hashDigestSize(algorithm);
+    _header.blockSize = blockSize;
+    _header.serialize(header);
+    _output.write(header, sizeof(header));
+}
+
+BinarySignatureWriter::BinarySignatureWriter(const string &outputFile, HashAlgorithm algorithm, size_t blockSize,
+                                             const ResumePoint &point, size_t flushInterval) :
+    _output(outputFile, point.outputSize, flushInterval)
+{
+    _header.algorithm = static_cast<uint32_t>(algorithm);
+    _header.digestSize = hashDigestSize(algorithm);
+    _header.blockSize = blockSize;
+    _header.blockCount = point.blockCount;
+
+    if (point.outputSize < SignatureHeader::size) // nothing was kept
+    {
+        uint8_t header[SignatureHeader::size];
+        _header.serialize(header);
+        _output.write(header, sizeof(header));
+    }
+}
+
+void BinarySignatureWriter::write(const Digest &digest)
+{
+    if (_tree)
+    {
+        _tree->add(digest);
+    }
+
+    _output.write(digest.data(), digest.size());
+    _output.endRecord();
+    ++_header.blockCount;
+}
+
+void BinarySignatureWriter::finish(uint64_t inputSize)
+{
+    uint8_t header[SignatureHeader::size];
+
+    if (_tree)
+    {
+        Digest root = _tree->finish();
+        const auto &levels = _tree->levels();
+
+        for (size_t level = 0; level + 1 < levels.size(); ++level)
+        {
+            for (const auto &node : levels[level])
+            {
+                _output.write(node.data(), node.size());
+            }
+        }
+
+        _output.write(root.data(), root.size());
+        _header.flags |= _treeMode == TreeMode::Levels ? SignatureHeader::treeRoot | SignatureHeader::treeLevels :
+                         SignatureHeader::treeRoot;
+    }
+
+    if (_fileDigest.size() > 0)
+    {
+        _output.write(_fileDigest.data(), _fileDigest.size());
+        _header.flags |= SignatureHeader::fileDigest;
+    }
+
+    if (_shard)
+    {
+        _header.flags |= SignatureHeader::shard;
+        _header.firstBlock = _shardFirst;
+    }
+
+    _header.inputSize = _shard ? _shardInputSize : inputSize;
+    _header.serialize(header);
+    _output.writeAt(header, sizeof(header), 0);
+}
+
+uint64_t BinarySignatureWriter::sync()
+{
+    _output.sync();
+    return _output.size();
+}
+
+ManifestWriter::ManifestWriter(const string &outputFile, HashAlgorithm algorithm, size_t blockSize,
+                               size_t flushInterval) :
+    _output(outputFile, false, flushInterval)
+{
+    string line = string("# manifest ") + hashAlgorithmName(algorithm) + " " + to_string(blockSize) + "\n";
+    _output.write(line.data(), line.size());
+}
+
+void ManifestWriter::addFile(const string &path, uint64_t blockCount)
+{
+    string escaped;
+
+    for (char c : path)
+    {
+        if (c == '\\')
+        {
+            escaped += "\\\\";
+        }
+        else if (c == '\n')
+        {
+            escaped += "\\n";
+        }
+        else
+        {
+            escaped += c;
+        }
+    }
+
+    lock_guard<mutex> locker(_m);
+    _files.emplace_back(move(escaped), blockCount);
+}
+
+void ManifestWriter::write(const Digest &digest)
+{
+    if (_block == _blockCount) // the current file is over
+    {
+        lock_guard<mutex> locker(_m);
+
+        if (_files.empty())
+        {
+            throw logic_error("digest of unknown file");
+        }
+
+        _path = move(_files.front().first);
+        _blockCount = _files.front().second;
+        _files.pop_front();
+        _block = 0;
+    }
+
+    char line[2 * Digest::maxSize + 32];
+    size_t length = digest.toHex(line);
+    length += snprintf(line + length, sizeof(line) - length, " %llu ", static_cast<unsigned long long>(_block++));
+    _output.write(line, length);
+    _output.write(_path.data(), _path.size());
+    _output.write("\n", 1);
+    _output.endRecord();
+}
+
+void ManifestWriter::finish(uint64_t)
+{
+    _output.flush();
+}
+
+ChunkWriter::ChunkWriter(const string &outputFile, HashAlgorithm algorithm, size_t minSize, size_t averageSize,
+                         size_t maxSize, size_t flushInterval) :
+    _output(outputFile, false, flushInterval)
+{
+    string line = string("# chunks ") + hashAlgorithmName(algorithm) + " " + to_string(minSize) + " " +
+                  to_string(averageSize) + " " + to_string(maxSize) + "\n";
+    _output.write(line.data(), line.size());
+}
+
+void ChunkWriter::addChunks(vector<Chunk> chunks)
+{
+    if (!chunks.empty())
+    {
+        lock_guard<mutex> locker(_m);
+        _pending.push_back(move(chunks));
+    }
+}
+
+void ChunkWriter::write(const Digest &digest)
+{
+    if (_next == _current.size()) // lock is taken once per announcement
+    {
+        lock_guard<mutex> locker(_m);
+
+        if (_pending.empty())
+        {
+            throw logic_error("digest of unknown chunk");
+        }
+
+        _current = move(_pending.front());
+        _pending.pop_front();
+        _next = 0;
+    }
+
+    const Chunk &chunk = _current[_next++];
+    char line[2 * Digest::maxSize + 48];
+    size_t length = digest.toHex(line);
+    length += snprintf(line + length, sizeof(line) - length, " %llu %llu\n",
+                       static_cast<unsigned long long>(chunk.offset), static_cast<unsigned long long>(chunk.length));
+    _output.write(line, length);
+    _output.endRecord();
+}
+
+void ChunkWriter::finish(uint64_t)
+{
+    _output.flush();
+}
+
+SignatureFile::SignatureFile(const string &fileName)
+{
+    int fd = open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
+    {
+        throw invalid_argument("cannot open file " + fileName);
+    }
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        throw runtime_error("cannot stat file " + fileName);
+    }
+
+    _mappingSize = st.st_size;
+
+    if (_mappingSize > 0)
+    {
+        _mapping = mmap(nullptr, _mappingSize, PROT_READ, MAP_SHARED, fd, 0);
+    }
+
+    close(fd);
+
+    if (_mapping == MAP_FAILED)
+    {
+        _mapping = nullptr;
+        throw runtime_error("cannot map file " + fileName + ": " + strerror(errno));
+    }
+
+    auto data = static_cast<const uint8_t *>(_mapping);
+
+    if (SignatureHeader::matches(data, _mappingSize))
+    {
+        try
+        {
+            _header = SignatureHeader::parse(data, _mappingSize);
+        }
+        catch (...)
+        {
+            munmap(_mapping, _mappingSize);
+            throw;
+        }
+
+        _format = SignatureFormat::Binary;
+        _digests = data + SignatureHeader::size;
+
+        if (_header.flags & SignatureHeader::treeRoot)
+        {
+            uint64_t nodes = _header.blockCount;
+
+            if (_header.flags & SignatureHeader::treeLevels)
+            {
+                auto sizes = MerkleTree::levelSizes(_header.blockCount);
+
+                for (size_t level = 1; level + 1 < sizes.size(); ++level)
+                {
+                    nodes += sizes[level];
+                }
+            }
+
+            if ((_mappingSize - SignatureHeader::size) / _header.digestSize < nodes + 1)
+            {
+                munmap(_mapping, _mappingSize);
+                throw runtime_error("truncated Merkle tree in signature " + fileName);
+            }
+
+            _root = _digests + nodes * _header.digestSize;
+        }
+
+        if (_header.flags & SignatureHeader::fileDigest)
+        {
+            // trailer follows the digests and the tree
+            const uint8_t *trailer = _root != nullptr ? _root + _header.digestSize :
+                                     _digests + _header.blockCount * _header.digestSize;
+
+            if (static_cast<size_t>(data + _mappingSize - trailer) < 16)
+            {
+                munmap(_mapping, _mappingSize);
+                throw runtime_error("truncated file digest in signature " + fileName);
+            }
+
+            _fileDigest = trailer;
+        }
+
+        return;
+    }
+
+    // text signature: optional algorithm line, one hex digest per line and optional tree
+    _format = SignatureFormat::Text;
+    _header.flags = SignatureHeader::sizeUnknown;
+    bool tree = false; // digest lines belong to tree levels
+
+    auto parseHex = [](const char *hex, size_t length, size_t size, vector<uint8_t> &out)
+    {
+        if (length != 2 * size)
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < length; i += 2)
+        {
+            int high = hexValue(hex[i]), low = hexValue(hex[i + 1]);
+
+            if (high < 0 || low < 0)
+            {
+                return false;
+            }
+
+            out.push_back(static_cast<uint8_t>(high << 4 | low));
+        }
+
+        return true;
+    };
+
+    for (size_t pos = 0; pos < _mappingSize;)
+    {
+        const char *line = reinterpret_cast<const char *>(data) + pos;
+        const void *newLine = memchr(line, '\n', _mappingSize - pos);
+        size_t length = newLine != nullptr ? static_cast<const char *>(newLine) - line : _mappingSize - pos;
+        pos += length + 1;
+
+        if (length > 0 && line[length - 1] == '\r')
+        {
+            --length;
+        }
+
+        if (length == 0)
+        {
+            continue;
+        }
+
+        if (length > 8 && strncmp(line, "# level ", 8) == 0)
+        {
+            tree = true;
+            _header.flags |= SignatureHeader::treeLevels;
+            continue;
+        }
+
+        if (length > 7 && strncmp(line, "# root ", 7) == 0)
+        {
+            _rootParsed.clear();
+
+            if (!parseHex(line + 7, length - 7, _header.digestSize, _rootParsed))
+            {
+                munmap(_mapping, _mappingSize);
+                throw runtime_error("wrong root in text signature " + fileName);
+            }
+
+            _header.flags |= SignatureHeader::treeRoot;
+            tree = true; // only trailer follows the root
+            continue;
+        }
+
+        if (length > 11 && strncmp(line, "# file md5 ", 11) == 0)
+        {
+            _fileDigestParsed.clear();
+
+            if (!parseHex(line + 11, length - 11, 16, _fileDigestParsed))
+            {
+                munmap(_mapping, _mappingSize);
+                throw runtime_error("wrong file digest in text signature " + fileName);
+            }
+
+            _header.flags |= SignatureHeader::fileDigest;
+            break;
+        }
+
+        if (length > 8 && strncmp(line, "# shard ", 8) == 0)
+        {
+            unsigned long long first, blockSize, inputSize;
+            char end;
+
+            if (sscanf(string(line + 8, length - 8).c_str(), "%llu %llu %llu %c", &first, &blockSize, &inputSize,
+                       &end) != 3)
+            {
+                munmap(_mapping, _mappingSize);
+                throw runtime_error("wrong shard line in text signature " + fileName);
+            }
+
+            _header.flags = (_header.flags & ~SignatureHeader::sizeUnknown) | SignatureHeader::shard;
+            _header.firstBlock = first;
+            _header.blockSize = blockSize;
+            _header.inputSize = inputSize;
+            break;
+        }
+
+        if (line[0] == '#')
+        {
+            try
+            {
+                string name(line + 1, length - 1);
+                name.erase(0, name.find_first_not_of(' '));
+                HashAlgorithm algorithm = parseHashAlgorithm(name);
+                _header.algorithm = static_cast<uint32_t>(algorithm);
+                _header.digestSize = hashDigestSize(algorithm);
+            }
+            catch (...)
+            {
+                munmap(_mapping, _mappingSize);
+                throw runtime_error("unknown algorithm in text signature " + fileName);
+            }
+
+            continue;
+        }
+
+        if (tree) // nodes of levels are not kept, they can be rebuilt from digests
+        {
+            continue;
+        }
+
+        if (!parseHex(line, length, _header.digestSize, _parsed))
+        {
+            munmap(_mapping, _mappingSize);
+            throw runtime_error("wrong digest in text signature " + fileName);
+        }
+    }
+
+    munmap(_mapping, _mappingSize);
+    _mapping = nullptr;
+    _header.blockCount = _parsed.size() / _header.digestSize;
+    _digests = _parsed.data();
+    _root = _rootParsed.empty() ? nullptr : _rootParsed.data();
+    _fileDigest = _fileDigestParsed.empty() ? nullptr : _fileDigestParsed.data();
+}
+
+SignatureFile::~SignatureFile()
+{
+    if (_mapping != nullptr)
+    {
+        munmap(_mapping, _mappingSize);
+    }
+}
+
+void convertSignature(const string &inputFile, const string &outputFile, SignatureFormat format, size_t blockSize)
+{
+    SignatureFile input(inputFile);
+    const SignatureHeader &header = input.header();
+    auto algorithm = static_cast<HashAlgorithm>(header.algorithm);
+
+    if (header.digestSize != hashDigestSize(algorithm)) // throws for unknown algorithm
+    {
+        throw runtime_error("unsupported signature algorithm");
+    }
+
+    shared_ptr<SignatureWriter> output;
+
+    if (format == SignatureFormat::Binary)
+    {
+        auto binary = make_shared<BinarySignatureWriter>(outputFile, algorithm,
+                                                         header.blockSize > 0 ? header.blockSize : blockSize);
+        if (header.flags & SignatureHeader::sizeUnknown)
+        {
+            binary->setSizeUnknown();
+        }
+        output = binary;
+    }
+    else
+    {
+        output = make_shared<TextSignatureWriter>(outputFile, algorithm, false);
+    }
+
+    // tree is rebuilt from digests, so text signature without level nodes still converts fully
+    if (header.flags & SignatureHeader::treeLevels)
+    {
+        output->enableTree(algorithm, TreeMode::Levels);
+    }
+    else if (header.flags & SignatureHeader::treeRoot)
+    {
+        output->enableTree(algorithm, TreeMode::Root);
+    }
+
+    Digest digest(header.digestSize);
+
+    for (uint64_t i = 0; i < input.blockCount(); ++i)
+    {
+        memcpy(digest.data(), input.digest(i), digest.size());
+        output->write(digest);
+    }
+
+    if (input.fileDigest() != nullptr)
+    {
+        Digest fileDigest(16);
+        memcpy(fileDigest.data(), input.fileDigest(), fileDigest.size());
+        output->setFileDigest(fileDigest);
+    }
+
+    if (header.flags & SignatureHeader::shard)
+    {
+        output->setShard(header.firstBlock, header.blockSize, header.inputSize);
+    }
+
+    output->finish(header.inputSize);
+}
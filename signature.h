@@ -0,0 +1,442 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "hash_algorithm.h"
+#include "merkle_tree.h"
+#include "output_file.h"
+
+/**
+ * @brief      Signature file formats.
+ */
+enum class SignatureFormat
+{
+    Text,   // one hex digest per line
+    Binary  // header followed by packed raw digests
+};
+
+/**
+ * @brief      Parses format name: "text" or "binary".
+ *
+ * @param[in]  name  The name.
+ *
+ * @return     The format.
+ *
+ * @throws     std::invalid_argument for unknown name.
+ */
+SignatureFormat parseSignatureFormat(const std::string &name);
+
+/**
+ * @brief      Header of binary signature, stored little-endian at the file start.
+ *
+ * Digests follow the header without gaps, so digest of block i is located at
+ * SignatureHeader::size + i * digestSize. Signature with Merkle tree continues
+ * with nodes of levels from 1 to the one below the root when all levels are
+ * stored, and the root digest. 16 bytes of whole-file MD5 are the last when
+ * present. Shard signature holds digests of blocks from firstBlock, and its
+ * inputSize is the size of the whole input.
+ */
+struct SignatureHeader
+{
+    static const size_t size = 64;        // serialized size with reserved space
+    static const uint32_t currentVersion = 1;
+    static const uint32_t sizeUnknown = 1; // flag: inputSize is not known
+    static const uint32_t treeRoot = 2;    // flag: Merkle tree root follows digests
+    static const uint32_t treeLevels = 4;  // flag: all Merkle tree levels follow digests
+    static const uint32_t fileDigest = 8;  // flag: MD5 of the whole input ends the signature
+    static const uint32_t shard = 16;      // flag: digests are of a range of blocks starting at firstBlock
+
+    uint32_t version = currentVersion;
+    uint32_t algorithm = static_cast<uint32_t>(HashAlgorithm::Md5);
+    uint32_t digestSize = 16;
+    uint32_t flags = 0;
+    uint64_t blockSize = 0;
+    uint64_t inputSize = 0;
+    uint64_t blockCount = 0;
+    uint64_t firstBlock = 0;
+
+    /**
+     * @brief      Serializes the header.
+     *
+     * @param      out   Destination of size bytes.
+     */
+    void serialize(uint8_t *out) const;
+
+    /**
+     * @brief      Checks magic and parses the header.
+     *
+     * @param[in]  data    The data.
+     * @param[in]  length  The data length.
+     *
+     * @return     The header.
+     *
+     * @throws     std::runtime_error if data is not a binary signature.
+     */
+    static SignatureHeader parse(const uint8_t *data, size_t length);
+
+    /**
+     * @brief      Checks if data starts with binary signature magic.
+     */
+    static bool matches(const uint8_t *data, size_t length);
+};
+
+/**
+ * @brief      Part of signature durably written by an interrupted run.
+ */
+struct ResumePoint
+{
+    uint64_t blockCount = 0; // digests kept
+    uint64_t outputSize = 0; // signature bytes holding them
+};
+
+/**
+ * @brief      Abstract class for signature output.
+ */
+class SignatureWriter
+{
+public:
+    virtual ~SignatureWriter() = default;
+
+    /**
+     * @brief      Writes digest of the next block.
+     *
+     * @param[in]  digest  The digest.
+     */
+    virtual void write(const Digest &digest) = 0;
+
+    /**
+     * @brief      Completes the signature.
+     *
+     * @param[in]  inputSize  The hashed input size in bytes.
+     */
+    virtual void finish(uint64_t inputSize) = 0;
+
+    /**
+     * @brief      Makes all written digests durable.
+     *
+     * @return     Signature size in bytes, 0 for writers without output file.
+     */
+    virtual uint64_t sync()
+    {
+        return 0;
+    }
+
+    /**
+     * @brief      Sets MD5 digest of the whole input, finish() writes it as trailer.
+     *
+     * @param[in]  digest  The digest.
+     */
+    virtual void setFileDigest(const Digest &digest)
+    {
+        _fileDigest = digest;
+    }
+
+    /**
+     * @brief      Tags signature as shard holding a range of blocks, finish() records it.
+     *
+     * @param[in]  firstBlock  The index of the first block of the range.
+     * @param[in]  blockSize   The block size in bytes.
+     * @param[in]  inputSize   The size of the whole input, recorded instead of the size given to finish().
+     */
+    virtual void setShard(uint64_t firstBlock, uint64_t blockSize, uint64_t inputSize)
+    {
+        _shard = true;
+        _shardFirst = firstBlock;
+        _shardBlockSize = blockSize;
+        _shardInputSize = inputSize;
+    }
+
+    /**
+     * @brief      Builds Merkle tree over written digests, finish() writes it after them.
+     *
+     * Must be called before the first digest.
+     *
+     * @param[in]  algorithm  The algorithm of digests.
+     * @param[in]  mode       The tree mode.
+     */
+    void enableTree(HashAlgorithm algorithm, TreeMode mode)
+    {
+        _treeMode = mode;
+        _tree = mode != TreeMode::None ? std::make_unique<MerkleTree>(algorithm, mode == TreeMode::Levels) : nullptr;
+    }
+
+    /**
+     * @brief      Creates writer of given format.
+     *
+     * @param[in]  outputFile     The output file.
+     * @param[in]  format         The format.
+     * @param[in]  algorithm      The hash algorithm of digests.
+     * @param[in]  blockSize      The block size in bytes.
+     * @param[in]  append         Append text signature to existing file.
+     * @param[in]  flushInterval  Flush output every this number of digests, 0 to flush only when buffer is full.
+     * @param[in]  tree           Merkle tree to store, signature with tree is never appended.
+     *
+     * @return     The writer.
+     */
+    static std::shared_ptr<SignatureWriter> create(const std::string &outputFile, SignatureFormat format,
+                                                   HashAlgorithm algorithm, size_t blockSize,
+                                                   bool append = true, size_t flushInterval = 0,
+                                                   TreeMode tree = TreeMode::None);
+
+    /**
+     * @brief      Continues signature of an interrupted run after its durable part.
+     *
+     * Kept digests are checked to match the format, algorithm and block size,
+     * and are added to the Merkle tree. Anything after the kept part is cut off.
+     *
+     * @param[in]  outputFile     The existing signature.
+     * @param[in]  format         The format.
+     * @param[in]  algorithm      The hash algorithm of digests.
+     * @param[in]  blockSize      The block size in bytes.
+     * @param[in]  point          The durable part of the signature.
+     * @param[in]  flushInterval  Flush output every this number of digests, 0 to flush only when buffer is full.
+     * @param[in]  tree           Merkle tree to store.
+     *
+     * @return     The writer, the next digest written is of block point.blockCount.
+     *
+     * @throws     std::runtime_error if kept part of the signature does not match.
+     */
+    static std::shared_ptr<SignatureWriter> resume(const std::string &outputFile, SignatureFormat format,
+                                                   HashAlgorithm algorithm, size_t blockSize,
+                                                   const ResumePoint &point, size_t flushInterval = 0,
+                                                   TreeMode tree = TreeMode::None);
+protected:
+    TreeMode _treeMode = TreeMode::None;
+    std::unique_ptr<MerkleTree> _tree; // built over written digests
+    Digest _fileDigest{0}; // MD5 of the whole input, empty if not computed
+    bool _shard = false;   // signature holds a range of blocks
+    uint64_t _shardFirst = 0;
+    uint64_t _shardBlockSize = 0;
+    uint64_t _shardInputSize = 0;
+};
+
+/**
+ * @brief      Writer of text signature, one hex digest per line.
+ *
+ * Algorithm other than MD5 is recorded in "# <name>" line before the digests.
+ * Merkle tree follows the digests as "# level <k>" lines with nodes of the
+ * level after each when all levels are stored, and "# root <hex>" line.
+ * Whole-file MD5 is the last "# file md5 <hex>" line. Shard signature ends
+ * with "# shard <first block> <block size> <input size>" line.
+ */
+class TextSignatureWriter : public SignatureWriter
+{
+public:
+    TextSignatureWriter(const std::string &outputFile, HashAlgorithm algorithm, bool append, size_t flushInterval = 0);
+
+    /**
+     * @brief      Continues signature after its kept part, see SignatureWriter::resume().
+     */
+    TextSignatureWriter(const std::string &outputFile, HashAlgorithm algorithm, const ResumePoint &point,
+                        size_t flushInterval = 0);
+    virtual void write(const Digest &digest) override;
+    virtual void finish(uint64_t inputSize) override;
+    virtual uint64_t sync() override;
+private:
+    OutputFile _output;
+
+    void writeLine(const Digest &digest);
+};
+
+/**
+ * @brief      Writer of binary signature.
+ *
+ * Header is written with zero block count first and is completed by finish().
+ */
+class BinarySignatureWriter : public SignatureWriter
+{
+public:
+    BinarySignatureWriter(const std::string &outputFile, HashAlgorithm algorithm, size_t blockSize,
+                          size_t flushInterval = 0);
+
+    /**
+     * @brief      Continues signature after its kept part, see SignatureWriter::resume().
+     */
+    BinarySignatureWriter(const std::string &outputFile, HashAlgorithm algorithm, size_t blockSize,
+                          const ResumePoint &point, size_t flushInterval = 0);
+    virtual void write(const Digest &digest) override;
+    virtual void finish(uint64_t inputSize) override;
+    virtual uint64_t sync() override;
+
+    /**
+     * @brief      Marks input size as unknown, used by conversion from text.
+     */
+    void setSizeUnknown()
+    {
+        _header.flags |= SignatureHeader::sizeUnknown;
+    }
+private:
+    OutputFile _output;
+    SignatureHeader _header;
+};
+
+/**
+ * @brief      Writer of batch manifest, one "<hex digest> <block index> <path>" line per block.
+ *
+ * Manifest starts with "# manifest <algorithm> <block size>" line. Digests come
+ * in the same order as files are announced with addFile(), so the writer knows
+ * the file and index of every digest. Backslash and new line in paths are
+ * escaped as "\\" and "\n".
+ */
+class ManifestWriter : public SignatureWriter
+{
+public:
+    ManifestWriter(const std::string &outputFile, HashAlgorithm algorithm, size_t blockSize,
+                   size_t flushInterval = 0);
+    virtual void write(const Digest &digest) override;
+    virtual void finish(uint64_t inputSize) override;
+
+    /**
+     * @brief      Announces the next file, must be called before its digests are written.
+     *
+     * @param[in]  path        The file path.
+     * @param[in]  blockCount  The number of blocks, positive.
+     */
+    void addFile(const std::string &path, uint64_t blockCount);
+private:
+    OutputFile _output;
+    std::mutex _m; // protects _files shared by reading and writing threads
+    std::deque<std::pair<std::string, uint64_t>> _files; // announced files not started yet
+    std::string _path;       // escaped path of the current file
+    uint64_t _block = 0;     // next block index of the current file
+    uint64_t _blockCount = 0;
+};
+
+/**
+ * @brief      Writer of content-defined chunk list, one "<hex digest> <offset> <length>" line per chunk.
+ *
+ * List starts with "# chunks <algorithm> <min> <average> <max>" line. Digests
+ * come in the same order as chunks are announced with addChunks().
+ */
+class ChunkWriter : public SignatureWriter
+{
+public:
+    /**
+     * @brief      Chunk of input.
+     */
+    struct Chunk
+    {
+        uint64_t offset;
+        uint64_t length;
+    };
+
+    ChunkWriter(const std::string &outputFile, HashAlgorithm algorithm, size_t minSize, size_t averageSize,
+                size_t maxSize, size_t flushInterval = 0);
+    virtual void write(const Digest &digest) override;
+    virtual void finish(uint64_t inputSize) override;
+
+    /**
+     * @brief      Announces the next chunks, must be called before their digests are written.
+     *
+     * @param[in]  chunks  The chunks in input order.
+     */
+    void addChunks(std::vector<Chunk> chunks);
+private:
+    OutputFile _output;
+    std::mutex _m; // protects _pending shared by reading and writing threads
+    std::deque<std::vector<Chunk>> _pending; // announced chunks not started yet
+    std::vector<Chunk> _current; // chunks of the current announcement
+    size_t _next = 0;            // index of the next chunk in _current
+};
+
+/**
+ * @brief      Signature file opened for reading.
+ *
+ * Binary signature is memory mapped and digests are accessed in place, text one
+ * is parsed to memory.
+ */
+class SignatureFile
+{
+public:
+    /**
+     * @brief      Opens signature, format is detected by magic.
+     *
+     * Text signature without algorithm line holds MD5 digests.
+     *
+     * @param[in]  fileName  The file name.
+     */
+    SignatureFile(const std::string &fileName);
+    ~SignatureFile();
+
+    SignatureFile(const SignatureFile &) = delete;
+    SignatureFile &operator=(const SignatureFile &) = delete;
+
+    SignatureFormat format() const
+    {
+        return _format;
+    }
+
+    /**
+     * @brief      Gets the header, text signature has block and input sizes unknown unless it is a shard.
+     */
+    const SignatureHeader &header() const
+    {
+        return _header;
+    }
+
+    uint64_t blockCount() const
+    {
+        return _header.blockCount;
+    }
+
+    /**
+     * @brief      Gets root of Merkle tree.
+     *
+     * @return     Pointer to header().digestSize bytes, nullptr if signature has no tree.
+     */
+    const uint8_t *root() const
+    {
+        return _root;
+    }
+
+    /**
+     * @brief      Gets MD5 digest of the whole input.
+     *
+     * @return     Pointer to 16 bytes, nullptr if signature has no file digest.
+     */
+    const uint8_t *fileDigest() const
+    {
+        return _fileDigest;
+    }
+
+    /**
+     * @brief      Gets digest of block in O(1).
+     *
+     * @param[in]  index  The block index, must be less than blockCount().
+     *
+     * @return     Pointer to header().digestSize bytes.
+     */
+    const uint8_t *digest(uint64_t index) const
+    {
+        return _digests + index * _header.digestSize;
+    }
+
+private:
+    SignatureFormat _format;
+    SignatureHeader _header;
+    const uint8_t *_digests = nullptr;
+    const uint8_t *_root = nullptr;
+    const uint8_t *_fileDigest = nullptr;
+    void *_mapping = nullptr;       // mapping of binary signature
+    size_t _mappingSize = 0;
+    std::vector<uint8_t> _parsed;   // digests of text signature
+    std::vector<uint8_t> _rootParsed; // tree root of text signature
+    std::vector<uint8_t> _fileDigestParsed; // file digest of text signature
+};
+
+/**
+ * @brief      Converts signature between text and binary formats.
+ *
+ * @param[in]  inputFile   The input signature, format is detected.
+ * @param[in]  outputFile  The output signature, overwritten.
+ * @param[in]  format      The output format.
+ * @param[in]  blockSize   The block size recorded in binary output converted from text.
+ */
+void convertSignature(const std::string &inputFile, const std::string &outputFile,
+                      SignatureFormat format, size_t blockSize);
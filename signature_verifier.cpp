@@ -0,0 +1,57 @@
+#include "signature_verifier.h"
+
+#include <cstring>
+
+using namespace std;
+
+SignatureVerifier::SignatureVerifier(shared_ptr<const SignatureFile> expected, bool stopAtFirst) :
+    _expected(move(expected)),
+    _stopAtFirst(stopAtFirst)
+{
+}
+
+void SignatureVerifier::write(const Digest &digest)
+{
+    uint64_t block = _blockCount++;
+
+    if (block >= _expected->blockCount() || digest.size() != _expected->header().digestSize ||
+            memcmp(digest.data(), _expected->digest(block), digest.size()) != 0)
+    {
+        addMismatch(block);
+    }
+}
+
+void SignatureVerifier::finish(uint64_t inputSize)
+{
+    const SignatureHeader &header = _expected->header();
+
+    if (!(header.flags & SignatureHeader::sizeUnknown))
+    {
+        _sizeMatches = header.inputSize == inputSize;
+    }
+
+    // blocks of signature beyond the end of input
+    for (uint64_t block = _blockCount; block < _expected->blockCount(); ++block)
+    {
+        addMismatch(block);
+    }
+
+    _finished = true;
+}
+
+void SignatureVerifier::addMismatch(uint64_t block)
+{
+    if (!_mismatches.empty() && _mismatches.back().last + 1 == block)
+    {
+        _mismatches.back().last = block;
+    }
+    else
+    {
+        _mismatches.push_back({block, block});
+    }
+
+    if (_stopAtFirst)
+    {
+        throw SignatureMismatch(block);
+    }
+}
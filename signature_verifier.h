@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "signature.h"
+
+/**
+ * @brief      Thrown by SignatureVerifier on the first mismatch when it stops early.
+ */
+class SignatureMismatch : public std::runtime_error
+{
+public:
+    SignatureMismatch(uint64_t block) :
+        std::runtime_error("block " + std::to_string(block) + " does not match signature"),
+        _block(block)
+    {
+    }
+
+    uint64_t block() const
+    {
+        return _block;
+    }
+private:
+    uint64_t _block;
+};
+
+/**
+ * @brief      Inclusive range of block indexes.
+ */
+struct BlockRange
+{
+    uint64_t first;
+    uint64_t last;
+};
+
+/**
+ * @brief      Compares digests of rehashed input with existing signature.
+ *
+ * It takes place of the signature writer in the hashing pipeline, so digests
+ * come in block order and nothing is written to disk. Blocks missing in the
+ * signature or in the input are reported as mismatching too.
+ */
+class SignatureVerifier : public SignatureWriter
+{
+public:
+    /**
+     * @brief      Constructs the verifier.
+     *
+     * @param[in]  expected     The signature to compare with.
+     * @param[in]  stopAtFirst  Throw SignatureMismatch on the first mismatching block.
+     */
+    SignatureVerifier(std::shared_ptr<const SignatureFile> expected, bool stopAtFirst);
+
+    virtual void write(const Digest &digest) override;
+    virtual void finish(uint64_t inputSize) override;
+
+    /**
+     * @brief      Gets mismatching blocks found so far, ranges are sorted and do not touch.
+     */
+    const std::vector<BlockRange> &mismatches() const
+    {
+        return _mismatches;
+    }
+
+    /**
+     * @brief      Gets the number of checked input blocks.
+     */
+    uint64_t blockCount() const
+    {
+        return _blockCount;
+    }
+
+    /**
+     * @brief      Checks that input size is the same as recorded in signature.
+     *
+     * Always true for text signature which has no input size.
+     */
+    bool sizeMatches() const
+    {
+        return _sizeMatches;
+    }
+
+    /**
+     * @brief      Checks that finish() was called and no mismatch was found.
+     */
+    bool passed() const
+    {
+        return _finished && _mismatches.empty() && _sizeMatches;
+    }
+private:
+    std::shared_ptr<const SignatureFile> _expected;
+    bool _stopAtFirst;
+    uint64_t _blockCount = 0;
+    bool _sizeMatches = true;
+    bool _finished = false;
+    std::vector<BlockRange> _mismatches;
+
+    /**
+     * @brief      Adds block to mismatching ranges, blocks come in increasing order.
+     */
+    void addMismatch(uint64_t block);
+};
@@ -0,0 +1,46 @@
+#include "sparse_map.h"
+
+#include <cerrno>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SparseMap::SparseMap(int fd, uint64_t size) : _fd(fd), _size(size)
+{
+    struct stat st;
+    _enabled = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+}
+
+bool SparseMap::isHole(uint64_t offset, uint64_t length)
+{
+    if (!_enabled || length == 0 || offset + length > _size)
+    {
+        return false;
+    }
+
+    if (offset >= _dataEnd) // cached extent is behind, looking for the next one
+    {
+        off_t data = lseek(_fd, offset, SEEK_DATA);
+
+        if (data < 0)
+        {
+            if (errno != ENXIO) // holes are not supported
+            {
+                _enabled = false;
+                return false;
+            }
+
+            // no data up to the end of file
+            _dataBegin = _size;
+            _dataEnd = UINT64_MAX;
+        }
+        else
+        {
+            off_t hole = lseek(_fd, data, SEEK_HOLE);
+            _dataBegin = data;
+            _dataEnd = hole > data ? static_cast<uint64_t>(hole) : _size;
+        }
+    }
+
+    // no data between the refresh offset and the cached extent
+    return offset + length <= _dataBegin;
+}
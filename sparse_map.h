@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief      Finds holes of sparse input file with SEEK_DATA and SEEK_HOLE.
+ *
+ * Only the next data extent is cached, so queries must go with non-decreasing
+ * offsets. File offset of the descriptor is changed by queries, so it must not
+ * be used for sequential reads. Files without hole support, pipes and devices
+ * are reported as all data.
+ */
+class SparseMap
+{
+public:
+    /**
+     * @brief      Constructs the map.
+     *
+     * @param[in]  fd    The file descriptor.
+     * @param[in]  size  The file size in bytes.
+     */
+    SparseMap(int fd, uint64_t size);
+
+    /**
+     * @brief      Checks that range lies entirely in a hole, so it reads as zeros.
+     *
+     * @param[in]  offset  The range offset, not less than offset of the previous query.
+     * @param[in]  length  The range length, must be positive.
+     *
+     * @return     True if range has no data and ends within the file.
+     */
+    bool isHole(uint64_t offset, uint64_t length);
+private:
+    int _fd;
+    uint64_t _size;
+    bool _enabled;
+    uint64_t _dataBegin = 0; // next data extent at or after the last refresh offset
+    uint64_t _dataEnd = 0;
+};
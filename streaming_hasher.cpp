@@ -0,0 +1,192 @@
+#include "streaming_hasher.h"
+#include "file_handle.h"
+#include "md5_mb.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+StreamingHasher::StreamingHasher(size_t blockSize, size_t threads, size_t maxMemory, bool hugePages) :
+    MultiThreadHasher(blockSize, threads, hugePages)
+{
+    if (blockSize == 0)
+    {
+        throw invalid_argument("memory-bounded hashing needs positive block size");
+    }
+
+    // every thread holds a part of every block of its batch
+    size_t parts = max(threads, static_cast<size_t>(1)) * md5MultiLanes();
+    size_t blockPages = (blockSize + minPartSize - 1) / minPartSize;
+    _partSize = min(maxMemory / parts / minPartSize, blockPages) * minPartSize;
+
+    if (_partSize == 0)
+    {
+        throw invalid_argument("memory budget of " + to_string(maxMemory) + " bytes is less than " +
+                               to_string(parts * minPartSize) + " bytes needed by " + to_string(parts) +
+                               " blocks in flight");
+    }
+
+    _buffers = BufferPool::create(_partSize, parts, hugePages);
+}
+
+void StreamingHasher::readBlocks(const string &inputFile)
+{
+    // file is shared by tasks which can outlive this method
+    auto file = make_shared<FileHandle>(inputFile);
+
+    if (!file->isRegular() || FileHandle::isStream(inputFile)) // positioned standard input is read from there
+    {
+        readStream(*file);
+        return;
+    }
+
+    size_t fileSize = file->size();
+    _inputSize = fileSize;
+    SparseMap holes(file->get(), fileSize); // holes are found in main thread, tasks only skip them
+    size_t blockCount = endBlock(fileSize); // last block may be empty
+    size_t lanes = md5MultiLanes();
+
+    for (size_t first = _firstBlock; first < blockCount && !_exceptOccurred; first += lanes)
+    {
+        size_t count = min(lanes, blockCount - first);
+        uint64_t holeMask = 0; // bit per block of the batch, only full blocks are skipped
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            size_t offset = (first + i) * _size;
+
+            if (fileSize - min(offset, fileSize) >= _size && holes.isHole(offset, _size))
+            {
+                holeMask |= static_cast<uint64_t>(1) << i;
+            }
+        }
+
+        addHasherTask([this, file, fileSize, first, count, holeMask]()
+        {
+            vector<Digest> digests(count, holeMask != 0 ? zeroDigest() : Digest());
+            vector<size_t> indexes; // blocks of the batch to read
+            vector<size_t> lengths;
+            size_t longest = 0;
+            uint64_t bytes = 0;
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                size_t offset = (first + i) * _size;
+                size_t length = min(_size, fileSize - min(offset, fileSize));
+                bytes += length;
+
+                if (!(holeMask & (static_cast<uint64_t>(1) << i)))
+                {
+                    indexes.push_back(i);
+                    lengths.push_back(length);
+                    longest = max(longest, length);
+                }
+            }
+
+            if (!indexes.empty())
+            {
+                vector<shared_ptr<Buffer>> parts;
+                vector<const uint8_t *> data;
+                vector<size_t> lens(indexes.size());
+                auto streams = HashStreams::create(_algorithm, indexes.size());
+
+                for (size_t j = 0; j < indexes.size(); ++j)
+                {
+                    parts.push_back(acquireBuffer());
+                    data.push_back(parts.back()->get());
+                }
+
+                // blocks advance together, so MD5 lanes stay busy until the shorter last block ends
+                for (size_t done = 0; done < longest; done += _partSize)
+                {
+                    for (size_t j = 0; j < indexes.size(); ++j)
+                    {
+                        lens[j] = min(_partSize, lengths[j] - min(done, lengths[j]));
+
+                        if (lens[j] > 0)
+                        {
+                            StageTimer timer(_stats.get(), Stage::Read);
+                            file->readAt(parts[j]->get(), lens[j], (first + indexes[j]) * _size + done);
+                        }
+                    }
+
+                    StageTimer timer(_stats.get(), Stage::Hash);
+                    streams->update(data.data(), lens.data());
+                }
+
+                vector<Digest> hashed(indexes.size());
+                streams->finish(hashed.data());
+
+                for (size_t j = 0; j < indexes.size(); ++j)
+                {
+                    digests[indexes[j]] = hashed[j];
+                }
+            }
+
+            if (_stats)
+            {
+                _stats->addBlocks(count, bytes);
+            }
+
+            return digests;
+        });
+    }
+}
+
+void StreamingHasher::readStream(FileHandle &input)
+{
+    auto part = acquireBuffer();
+    const uint8_t *data = part->get();
+    size_t lanes = md5MultiLanes();
+    bool last = false;
+
+    input.skip(_firstBlock * _size);
+
+    while (!last && !_exceptOccurred)
+    {
+        // blocks arrive one after another, so they are hashed here and only digests go through the pool
+        vector<Digest> digests;
+
+        while (digests.size() < lanes && !last)
+        {
+            auto streams = HashStreams::create(_algorithm, 1);
+            size_t length = 0;
+
+            while (length < _size)
+            {
+                size_t wanted = min(_partSize, _size - length);
+                size_t count;
+
+                {
+                    StageTimer timer(_stats.get(), Stage::Read);
+                    count = input.read(part->get(), wanted);
+                }
+
+                {
+                    StageTimer timer(_stats.get(), Stage::Hash);
+                    streams->update(&data, &count);
+                }
+
+                length += count;
+
+                if (count < wanted) // last block read
+                {
+                    last = true;
+                    break;
+                }
+            }
+
+            digests.emplace_back();
+            streams->finish(&digests.back());
+            _inputSize += length;
+
+            if (_stats)
+            {
+                _stats->addBlocks(1, length);
+            }
+        }
+
+        addHasherTask([digests]() { return digests; });
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "block_hasher.h"
+
+#include <string>
+
+/**
+ * @brief      Multi thread hasher holding only parts of blocks in memory.
+ *
+ * Every block is read and fed to its hash context by parts through incremental
+ * hashing, so memory use depends on the budget and not on the block size.
+ * Threads read their own blocks of regular files with positional reads, a
+ * batch of blocks is hashed part by part in lanes of the MD5 kernel. Stream
+ * input is read and hashed by the reader one block after another.
+ */
+class StreamingHasher : public MultiThreadHasher
+{
+public:
+    static const size_t minPartSize = 4096;
+
+    /**
+     * @brief      Constructs the memory-bounded hasher.
+     *
+     * @param[in]  blockSize  The block size in bytes.
+     * @param[in]  threads    The number of hasher threads.
+     * @param[in]  maxMemory  The budget for block data in bytes.
+     * @param[in]  hugePages  Back part buffers with huge pages.
+     *
+     * @throws     std::invalid_argument if the budget gives less than minPartSize bytes per block of a batch.
+     */
+    StreamingHasher(size_t blockSize, size_t threads, size_t maxMemory, bool hugePages = false);
+
+    /**
+     * @brief      Gets the size of block parts read at once.
+     */
+    size_t partSize() const
+    {
+        return _partSize;
+    }
+protected:
+    virtual void readBlocks(const std::string &inputFile) override;
+
+    // every worker reads its own blocks
+    virtual bool workersReadBlocks() const override
+    {
+        return true;
+    }
+
+    // blocks are never whole in memory
+    virtual bool supportsFileDigest() const override
+    {
+        return false;
+    }
+private:
+    size_t _partSize; // bytes of a block read and hashed at once
+
+    /**
+     * @brief      Reads and hashes stream input in the calling thread.
+     *
+     * @param      input  The input.
+     */
+    void readStream(FileHandle &input);
+};
@@ -0,0 +1,87 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+using namespace std;
+
+ThreadPool::ThreadPool(size_t threads, size_t queueCapacity) :
+    _capacity(max(static_cast<size_t>(1), queueCapacity))
+{
+    threads = max(static_cast<size_t>(1), threads);
+    _workers.reserve(threads);
+
+    for (size_t i = 0; i < threads; ++i)
+    {
+        _workers.emplace_back(&ThreadPool::workerThread, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> locker(_m);
+        _stop = true;
+    }
+
+    _taskCv.notify_all();
+
+    for (auto &worker : _workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::post(function<void()> func)
+{
+    {
+        unique_lock<mutex> locker(_m);
+        _spaceCv.wait(locker, [this]() { return _tasks.size() < _capacity; });
+        _tasks.push(move(func));
+    }
+
+    _taskCv.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    unique_lock<mutex> locker(_m);
+    _idleCv.wait(locker, [this]() { return _tasks.empty() && _active == 0; });
+}
+
+void ThreadPool::workerThread()
+{
+    while (true)
+    {
+        function<void()> task;
+
+        {
+            unique_lock<mutex> locker(_m);
+            _taskCv.wait(locker, [this]() { return _stop || !_tasks.empty(); });
+
+            if (_tasks.empty()) // stopped and nothing left to do
+            {
+                return;
+            }
+
+            task = move(_tasks.front());
+            _tasks.pop();
+            ++_active;
+        }
+
+        _spaceCv.notify_one();
+        task(); // exceptions are stored in the future of packaged task
+        task = nullptr; // captured data is released before the pool becomes idle
+
+        {
+            lock_guard<mutex> locker(_m);
+            --_active;
+
+            if (_active > 0 || !_tasks.empty())
+            {
+                continue;
+            }
+        }
+
+        _idleCv.notify_all();
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief      Fixed pool of long-lived worker threads fed by a bounded task queue.
+ */
+class ThreadPool
+{
+public:
+    /**
+     * @brief      Starts the worker threads.
+     *
+     * @param[in]  threads        Number of workers, at least one is started.
+     * @param[in]  queueCapacity  Maximum number of tasks waiting for a worker.
+     */
+    ThreadPool(size_t threads, size_t queueCapacity);
+
+    /**
+     * @brief      Finishes all queued tasks and joins the workers.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /**
+     * @brief      Queues a task, blocks while the queue is full.
+     *
+     * @param      func  The task.
+     *
+     * @return     Future of the task result, exceptions are delivered through it.
+     */
+    template <class F>
+    std::future<std::invoke_result_t<F>> submit(F &&func)
+    {
+        using Result = std::invoke_result_t<F>;
+        // std::function needs copyable target, so packaged task is shared
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(func));
+        auto result = task->get_future();
+
+        post([task]() { (*task)(); });
+        return result;
+    }
+
+    /**
+     * @brief      Queues a task without result, blocks while the queue is full.
+     *
+     * @param      func  The task, it must not throw.
+     */
+    void post(std::function<void()> func);
+
+    /**
+     * @brief      Waits until all queued tasks are finished.
+     */
+    void wait();
+
+    /**
+     * @brief      Gets the number of workers.
+     *
+     * @return     Workers count.
+     */
+    size_t size() const
+    {
+        return _workers.size();
+    }
+
+private:
+    std::vector<std::thread> _workers;          // worker threads
+    std::queue<std::function<void()>> _tasks;   // tasks waiting for a worker
+    size_t _capacity;                           // maximum size of _tasks
+    size_t _active = 0;                         // tasks being run by workers
+    bool _stop = false;                         // workers exit when queue is empty
+    std::mutex _m;                              // mutex for access to _tasks, _active and _stop
+    std::condition_variable _taskCv, _spaceCv;  // wake up workers and submitters
+    std::condition_variable _idleCv;            // wakes up wait()
+
+    /**
+     * @brief      Thread function of worker, runs tasks until pool is stopped.
+     */
+    void workerThread();
+};
@@ -0,0 +1,157 @@
+#include "uring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+static unsigned *ringField(void *ring, unsigned offset)
+{
+    return reinterpret_cast<unsigned *>(static_cast<uint8_t *>(ring) + offset);
+}
+
+IoUring::IoUring(unsigned entries)
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    _fd = syscall(__NR_io_uring_setup, entries, &params);
+
+    if (_fd < 0)
+    {
+        throw system_error(errno, generic_category(), "io_uring_setup");
+    }
+
+    _sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    _cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+
+    if (singleMmap)
+    {
+        _sqRingSize = _cqRingSize = max(_sqRingSize, _cqRingSize);
+    }
+
+    _sqRing = mmap(nullptr, _sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+    _cqRing = singleMmap ? _sqRing :
+              mmap(nullptr, _cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_CQ_RING);
+    _sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    void *sqes = mmap(nullptr, _sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES);
+
+    if (_sqRing == MAP_FAILED || _cqRing == MAP_FAILED || sqes == MAP_FAILED)
+    {
+        int error = errno;
+        _sqRing = _sqRing == MAP_FAILED ? nullptr : _sqRing;
+        _cqRing = _cqRing == MAP_FAILED ? nullptr : _cqRing;
+        _sqes = sqes == MAP_FAILED ? nullptr : static_cast<io_uring_sqe *>(sqes);
+        release();
+        throw system_error(error, generic_category(), "io_uring mmap");
+    }
+
+    _sqes = static_cast<io_uring_sqe *>(sqes);
+    _sqHead = ringField(_sqRing, params.sq_off.head);
+    _sqTail = ringField(_sqRing, params.sq_off.tail);
+    _sqMask = ringField(_sqRing, params.sq_off.ring_mask);
+    _sqArray = ringField(_sqRing, params.sq_off.array);
+    _cqHead = ringField(_cqRing, params.cq_off.head);
+    _cqTail = ringField(_cqRing, params.cq_off.tail);
+    _cqMask = ringField(_cqRing, params.cq_off.ring_mask);
+    _cqes = reinterpret_cast<io_uring_cqe *>(static_cast<uint8_t *>(_cqRing) + params.cq_off.cqes);
+    _sqEntries = params.sq_entries;
+}
+
+IoUring::~IoUring()
+{
+    release();
+}
+
+void IoUring::release()
+{
+    if (_sqes != nullptr)
+    {
+        munmap(_sqes, _sqesSize);
+    }
+
+    if (_cqRing != nullptr && _cqRing != _sqRing)
+    {
+        munmap(_cqRing, _cqRingSize);
+    }
+
+    if (_sqRing != nullptr)
+    {
+        munmap(_sqRing, _sqRingSize);
+    }
+
+    if (_fd >= 0)
+    {
+        close(_fd);
+        _fd = -1;
+    }
+}
+
+bool IoUring::prepareRead(int fd, const iovec *iov, uint64_t offset, uint64_t userData)
+{
+    unsigned tail = *_sqTail;
+
+    if (tail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE) >= _sqEntries)
+    {
+        return false;
+    }
+
+    unsigned index = tail & *_sqMask;
+    io_uring_sqe *sqe = &_sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(iov);
+    sqe->len = 1;
+    sqe->off = offset;
+    sqe->user_data = userData;
+
+    _sqArray[index] = index;
+    __atomic_store_n(_sqTail, tail + 1, __ATOMIC_RELEASE);
+    ++_toSubmit;
+    return true;
+}
+
+void IoUring::submit(unsigned waitCount)
+{
+    while (true)
+    {
+        int ret = syscall(__NR_io_uring_enter, _fd, _toSubmit, waitCount,
+                          waitCount > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+
+        if (ret >= 0)
+        {
+            _toSubmit -= min(static_cast<unsigned>(ret), _toSubmit);
+            return;
+        }
+
+        if (errno != EINTR)
+        {
+            throw system_error(errno, generic_category(), "io_uring_enter");
+        }
+    }
+}
+
+bool IoUring::popCompletion(uint64_t &userData, int &result)
+{
+    unsigned head = *_cqHead;
+
+    if (head == __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE))
+    {
+        return false;
+    }
+
+    const io_uring_cqe &cqe = _cqes[head & *_cqMask];
+    userData = cqe.user_data;
+    result = cqe.res;
+    __atomic_store_n(_cqHead, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
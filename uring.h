@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <sys/uio.h>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/**
+ * @brief      Minimal io_uring wrapper working directly with system calls.
+ */
+class IoUring
+{
+public:
+    /**
+     * @brief      Sets up the ring.
+     *
+     * @param[in]  entries  The submission queue size.
+     *
+     * @throws     std::system_error if io_uring is not available.
+     */
+    IoUring(unsigned entries);
+    ~IoUring();
+
+    IoUring(const IoUring &) = delete;
+    IoUring &operator=(const IoUring &) = delete;
+
+    /**
+     * @brief      Queues vectored read, it is passed to kernel by submit().
+     *
+     * @param[in]  fd        The file descriptor.
+     * @param[in]  iov       The buffer description, must live until completion.
+     * @param[in]  offset    The file offset.
+     * @param[in]  userData  The value returned with completion.
+     *
+     * @return     False if submission queue is full.
+     */
+    bool prepareRead(int fd, const iovec *iov, uint64_t offset, uint64_t userData);
+
+    /**
+     * @brief      Submits queued requests and waits for completions.
+     *
+     * @param[in]  waitCount  Number of completions to wait for.
+     */
+    void submit(unsigned waitCount);
+
+    /**
+     * @brief      Takes one completion if any.
+     *
+     * @param      userData  The user data of completed request.
+     * @param      result    The result of request, negative errno on failure.
+     *
+     * @return     False if there are no completions.
+     */
+    bool popCompletion(uint64_t &userData, int &result);
+
+private:
+    int _fd = -1;
+    unsigned _toSubmit = 0;       // prepared but not submitted entries
+
+    void *_sqRing = nullptr;      // submission ring mapping
+    size_t _sqRingSize = 0;
+    void *_cqRing = nullptr;      // completion ring mapping, may be the same as _sqRing
+    size_t _cqRingSize = 0;
+    io_uring_sqe *_sqes = nullptr;
+    size_t _sqesSize = 0;
+
+    unsigned *_sqHead, *_sqTail, *_sqMask, *_sqArray;
+    unsigned *_cqHead, *_cqTail, *_cqMask;
+    io_uring_cqe *_cqes;
+    unsigned _sqEntries;
+
+    /**
+     * @brief      Unmaps rings and closes ring descriptor.
+     */
+    void release();
+};
@@ -0,0 +1,195 @@
+#include "uring_hasher.h"
+#include "file_handle.h"
+#include "md5_mb.h"
+#include "uring.h"
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <system_error>
+
+using namespace std;
+
+/**
+ * @brief      Block read in flight.
+ */
+struct PendingRead
+{
+    shared_ptr<Buffer> buffer;
+    size_t index = 0;  // block index
+    size_t length = 0; // bytes to read
+    size_t done = 0;   // bytes already read
+    iovec iov;         // rest of the buffer to fill
+};
+
+/**
+ * @brief      Waits for reads in flight when the reader leaves, however it leaves.
+ *
+ * Kernel writes to block buffers until their reads complete, so buffers and the
+ * ring must not be released before.
+ */
+struct ReadDrain
+{
+    IoUring &ring;
+    size_t &inFlight; // reads prepared and not completed
+
+    ~ReadDrain()
+    {
+        uint64_t slot;
+        int result;
+
+        try
+        {
+            while (inFlight > 0)
+            {
+                ring.submit(1); // submits reads prepared after the last submit too
+
+                while (ring.popCompletion(slot, result))
+                {
+                    --inFlight;
+                }
+            }
+        }
+        catch (...)
+        {
+            // ring failed, its completions cannot be reaped any more
+        }
+    }
+};
+
+UringHasher::UringHasher(size_t blockSize, size_t threads, size_t queueDepth, bool hugePages) :
+    MultiThreadHasher(blockSize, threads, hugePages),
+    _queueDepth(max(static_cast<size_t>(1), queueDepth))
+{
+    // blocks in flight and waiting for a batch plus batches of all threads and the submitted one
+    size_t lanes = md5MultiLanes();
+    _buffers = BufferPool::create(_size, max(_queueDepth, lanes) + (max(threads, static_cast<size_t>(1)) + 1) * lanes,
+                                  hugePages);
+}
+
+void UringHasher::readBlocks(const string &inputFile)
+{
+    unique_ptr<IoUring> ring;
+
+    try
+    {
+        ring = make_unique<IoUring>(_queueDepth);
+    }
+    catch (const system_error &e)
+    {
+        MultiThreadHasher::readBlocks(inputFile); // io_uring is not available, reading with blocking calls
+        return;
+    }
+
+    FileHandle file(inputFile);
+    int fd = file.get();
+    size_t fileSize = file.size();
+    _inputSize = fileSize;
+    SparseMap holes(fd, fileSize);
+    size_t blockCount = endBlock(fileSize); // last block may be empty
+    size_t lanes = md5MultiLanes();
+    size_t window = max(_queueDepth, lanes); // blocks read but not submitted to hashers
+    vector<PendingRead> reads(_queueDepth);
+    vector<size_t> freeSlots;
+    map<size_t, shared_ptr<Buffer>> ready; // completed blocks by index
+    vector<shared_ptr<Buffer>> batch;
+    size_t nextRead = _firstBlock, nextHash = _firstBlock;
+    size_t inFlight = 0;
+
+    for (size_t i = 0; i < reads.size(); ++i)
+    {
+        freeSlots.push_back(i);
+    }
+
+    auto prepare = [&](PendingRead &read, size_t slot)
+    {
+        read.iov.iov_base = read.buffer->get() + read.done;
+        read.iov.iov_len = read.length - read.done;
+        ring->prepareRead(fd, &read.iov, read.index * _size + read.done, slot);
+        ++inFlight;
+    };
+
+    ReadDrain drain{*ring, inFlight}; // destroyed before reads and ring
+
+    while (nextHash < blockCount && !_exceptOccurred)
+    {
+        // keep the queue full
+        while (!freeSlots.empty() && nextRead < blockCount && nextRead - nextHash < window)
+        {
+            size_t offset = nextRead * _size;
+            size_t length = min(_size, fileSize - min(offset, fileSize));
+
+            if (length > 0 && holes.isHole(offset, length)) // zeros, nothing to read
+            {
+                ready.emplace(nextRead++, holeBlock(length));
+                continue;
+            }
+
+            auto buffer = acquireBuffer();
+            buffer->setSize(length);
+
+            if (length == 0) // empty last block, nothing to read
+            {
+                ready.emplace(nextRead++, move(buffer));
+                continue;
+            }
+
+            size_t slot = freeSlots.back();
+            freeSlots.pop_back();
+            reads[slot] = PendingRead{move(buffer), nextRead++, 0, 0, {}};
+            reads[slot].length = reads[slot].buffer->getSize();
+            prepare(reads[slot], slot);
+        }
+
+        bool waiting = freeSlots.size() < reads.size();
+
+        {
+            StageTimer timer(_stats.get(), Stage::Read); // submitting and waiting for completions
+            ring->submit(waiting && ready.count(nextHash) == 0 ? 1 : 0);
+        }
+
+        uint64_t slot;
+        int result;
+
+        while (ring->popCompletion(slot, result))
+        {
+            PendingRead &read = reads[slot];
+            --inFlight;
+
+            if (result < 0)
+            {
+                throw system_error(-result, generic_category(), "cannot read file " + inputFile);
+            }
+
+            if (result == 0)
+            {
+                throw runtime_error("unexpected end of file " + inputFile);
+            }
+
+            read.done += result;
+
+            if (read.done < read.length) // short read, requesting the rest
+            {
+                prepare(read, slot);
+                continue;
+            }
+
+            ready.emplace(read.index, move(read.buffer));
+            freeSlots.push_back(slot);
+        }
+
+        // blocks go to hashers in file order by full batches
+        while (!ready.empty() && ready.begin()->first == nextHash)
+        {
+            batch.push_back(move(ready.begin()->second));
+            ready.erase(ready.begin());
+            ++nextHash;
+
+            if (batch.size() == lanes || nextHash == blockCount)
+            {
+                addHasherTask(move(batch));
+                batch = vector<shared_ptr<Buffer>>();
+            }
+        }
+    }
+}
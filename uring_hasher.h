@@ -0,0 +1,30 @@
+#pragma once
+
+#include "block_hasher.h"
+
+#include <string>
+
+/**
+ * @brief      Multi thread hasher reading input with io_uring.
+ *
+ * Keeps a configured number of block reads in flight and hands completed blocks
+ * to hasher threads in file order. Falls back to buffered reading of
+ * MultiThreadHasher when io_uring is not available.
+ */
+class UringHasher : public MultiThreadHasher
+{
+public:
+    /**
+     * @brief      Constructs the io_uring hasher.
+     *
+     * @param[in]  blockSize   The block size in bytes.
+     * @param[in]  threads     The number of hasher threads.
+     * @param[in]  queueDepth  The number of reads in flight.
+     * @param[in]  hugePages   Back block buffers with huge pages.
+     */
+    UringHasher(size_t blockSize = 1024 * 1024, size_t threads = 4, size_t queueDepth = 32, bool hugePages = false);
+protected:
+    virtual void readBlocks(const std::string &inputFile) override;
+private:
+    size_t _queueDepth; // number of reads in flight
+};
@@ -0,0 +1,411 @@
+#include "xxh3.h"
+
+#include <cstring>
+
+namespace
+{
+
+const uint32_t prime32_1 = 0x9E3779B1U;
+const uint32_t prime32_2 = 0x85EBCA77U;
+const uint32_t prime32_3 = 0xC2B2AE3DU;
+const uint64_t prime64_1 = 0x9E3779B185EBCA87ULL;
+const uint64_t prime64_2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t prime64_3 = 0x165667B19E3779F9ULL;
+const uint64_t prime64_4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t prime64_5 = 0x27D4EB2F165667C5ULL;
+const uint64_t primeMx1 = 0x165667919E3779F9ULL;
+const uint64_t primeMx2 = 0x9FB21C651E98DF25ULL;
+
+const size_t secretSize = 192;
+const size_t stripeLen = 64;
+const size_t secretConsumeRate = 8;
+const size_t stripesPerBlock = (secretSize - stripeLen) / secretConsumeRate;
+const size_t blockLen = stripeLen * stripesPerBlock;
+
+const uint8_t secret[secretSize] =
+{
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+struct Hash128
+{
+    uint64_t low;
+    uint64_t high;
+};
+
+inline uint32_t readLe32(const uint8_t *p)
+{
+    return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+           static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+}
+
+inline uint64_t readLe64(const uint8_t *p)
+{
+    return static_cast<uint64_t>(readLe32(p)) | static_cast<uint64_t>(readLe32(p + 4)) << 32;
+}
+
+inline Hash128 mult64to128(uint64_t a, uint64_t b)
+{
+    unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+    return {static_cast<uint64_t>(product), static_cast<uint64_t>(product >> 64)};
+}
+
+inline uint64_t mul128Fold64(uint64_t a, uint64_t b)
+{
+    Hash128 product = mult64to128(a, b);
+    return product.low ^ product.high;
+}
+
+inline uint64_t xxh64Avalanche(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= prime64_2;
+    h ^= h >> 29;
+    h *= prime64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+inline uint64_t xxh3Avalanche(uint64_t h)
+{
+    h ^= h >> 37;
+    h *= primeMx1;
+    h ^= h >> 32;
+    return h;
+}
+
+Hash128 len1to3(const uint8_t *input, size_t len)
+{
+    uint32_t c1 = input[0], c2 = input[len >> 1], c3 = input[len - 1];
+    uint32_t combinedLow = c1 << 16 | c2 << 24 | c3 | static_cast<uint32_t>(len) << 8;
+    uint32_t swapped = __builtin_bswap32(combinedLow);
+    uint32_t combinedHigh = swapped << 13 | swapped >> 19;
+    uint64_t bitflipLow = readLe32(secret) ^ readLe32(secret + 4);
+    uint64_t bitflipHigh = readLe32(secret + 8) ^ readLe32(secret + 12);
+    return {xxh64Avalanche(combinedLow ^ bitflipLow), xxh64Avalanche(combinedHigh ^ bitflipHigh)};
+}
+
+Hash128 len4to8(const uint8_t *input, size_t len)
+{
+    uint64_t input64 = readLe32(input) + (static_cast<uint64_t>(readLe32(input + len - 4)) << 32);
+    uint64_t bitflip = readLe64(secret + 16) ^ readLe64(secret + 24);
+    Hash128 m = mult64to128(input64 ^ bitflip, prime64_1 + (len << 2));
+    m.high += m.low << 1;
+    m.low ^= m.high >> 3;
+    m.low ^= m.low >> 35;
+    m.low *= primeMx2;
+    m.low ^= m.low >> 28;
+    m.high = xxh3Avalanche(m.high);
+    return m;
+}
+
+Hash128 len9to16(const uint8_t *input, size_t len)
+{
+    uint64_t bitflipLow = readLe64(secret + 32) ^ readLe64(secret + 40);
+    uint64_t bitflipHigh = readLe64(secret + 48) ^ readLe64(secret + 56);
+    uint64_t inputLow = readLe64(input);
+    uint64_t inputHigh = readLe64(input + len - 8);
+    Hash128 m = mult64to128(inputLow ^ inputHigh ^ bitflipLow, prime64_1);
+    m.low += static_cast<uint64_t>(len - 1) << 54;
+    inputHigh ^= bitflipHigh;
+    m.high += inputHigh + static_cast<uint64_t>(static_cast<uint32_t>(inputHigh)) * (prime32_2 - 1);
+    m.low ^= __builtin_bswap64(m.high);
+    Hash128 h = mult64to128(m.low, prime64_2);
+    h.high += m.high * prime64_2;
+    return {xxh3Avalanche(h.low), xxh3Avalanche(h.high)};
+}
+
+inline uint64_t mix16(const uint8_t *input, const uint8_t *key, uint64_t seed)
+{
+    return mul128Fold64(readLe64(input) ^ (readLe64(key) + seed), readLe64(input + 8) ^ (readLe64(key + 8) - seed));
+}
+
+inline void mix32(Hash128 &acc, const uint8_t *input1, const uint8_t *input2, const uint8_t *key, uint64_t seed)
+{
+    acc.low += mix16(input1, key, seed);
+    acc.low ^= readLe64(input2) + readLe64(input2 + 8);
+    acc.high += mix16(input2, key + 16, seed);
+    acc.high ^= readLe64(input1) + readLe64(input1 + 8);
+}
+
+Hash128 finishMid(Hash128 acc, size_t len)
+{
+    uint64_t low = acc.low + acc.high;
+    uint64_t high = acc.low * prime64_1 + acc.high * prime64_4 + static_cast<uint64_t>(len) * prime64_2;
+    return {xxh3Avalanche(low), 0 - xxh3Avalanche(high)};
+}
+
+Hash128 len17to128(const uint8_t *input, size_t len)
+{
+    Hash128 acc = {len * prime64_1, 0};
+
+    if (len > 32)
+    {
+        if (len > 64)
+        {
+            if (len > 96)
+            {
+                mix32(acc, input + 48, input + len - 64, secret + 96, 0);
+            }
+
+            mix32(acc, input + 32, input + len - 48, secret + 64, 0);
+        }
+
+        mix32(acc, input + 16, input + len - 32, secret + 32, 0);
+    }
+
+    mix32(acc, input, input + len - 16, secret, 0);
+    return finishMid(acc, len);
+}
+
+Hash128 len129to240(const uint8_t *input, size_t len)
+{
+    const size_t startOffset = 3, lastOffset = 17, secretSizeMin = 136;
+    size_t rounds = len / 32;
+    Hash128 acc = {len * prime64_1, 0};
+
+    for (size_t i = 0; i < 4; ++i)
+    {
+        mix32(acc, input + 32 * i, input + 32 * i + 16, secret + 32 * i, 0);
+    }
+
+    acc.low = xxh3Avalanche(acc.low);
+    acc.high = xxh3Avalanche(acc.high);
+
+    for (size_t i = 4; i < rounds; ++i)
+    {
+        mix32(acc, input + 32 * i, input + 32 * i + 16, secret + startOffset + 32 * (i - 4), 0);
+    }
+
+    mix32(acc, input + len - 16, input + len - 32, secret + secretSizeMin - lastOffset - 16, 0);
+    return finishMid(acc, len);
+}
+
+inline void accumulate512(uint64_t acc[8], const uint8_t *input, const uint8_t *key)
+{
+    for (size_t i = 0; i < 8; ++i)
+    {
+        uint64_t value = readLe64(input + 8 * i);
+        uint64_t keyed = value ^ readLe64(key + 8 * i);
+        acc[i ^ 1] += value;
+        acc[i] += static_cast<uint64_t>(static_cast<uint32_t>(keyed)) * (keyed >> 32);
+    }
+}
+
+inline void scramble(uint64_t acc[8], const uint8_t *key)
+{
+    for (size_t i = 0; i < 8; ++i)
+    {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= readLe64(key + 8 * i);
+        a *= prime32_1;
+        acc[i] = a;
+    }
+}
+
+uint64_t mergeAccs(const uint64_t acc[8], const uint8_t *key, uint64_t start)
+{
+    uint64_t result = start;
+
+    for (size_t i = 0; i < 4; ++i)
+    {
+        result += mul128Fold64(acc[2 * i] ^ readLe64(key + 16 * i), acc[2 * i + 1] ^ readLe64(key + 16 * i + 8));
+    }
+
+    return xxh3Avalanche(result);
+}
+
+const size_t lastAccStart = 7, mergeAccsStart = 11;
+const uint64_t initAcc[8] = {prime32_3, prime64_1, prime64_2, prime64_3, prime64_4, prime32_2, prime64_5, prime32_1};
+
+/**
+ * @brief      Accumulates the last stripe of input and merges accumulators to the hash.
+ */
+Hash128 finishLong(uint64_t acc[8], const uint8_t *lastStripe, uint64_t len)
+{
+    accumulate512(acc, lastStripe, secret + secretSize - stripeLen - lastAccStart);
+
+    return {mergeAccs(acc, secret + mergeAccsStart, len * prime64_1),
+            mergeAccs(acc, secret + secretSize - 8 * sizeof(uint64_t) - mergeAccsStart, ~(len * prime64_2))};
+}
+
+Hash128 hashLong(const uint8_t *input, size_t len)
+{
+    uint64_t acc[8];
+    memcpy(acc, initAcc, sizeof(acc));
+    size_t blocks = (len - 1) / blockLen;
+
+    for (size_t n = 0; n < blocks; ++n)
+    {
+        for (size_t s = 0; s < stripesPerBlock; ++s)
+        {
+            accumulate512(acc, input + n * blockLen + s * stripeLen, secret + s * secretConsumeRate);
+        }
+
+        scramble(acc, secret + secretSize - stripeLen);
+    }
+
+    size_t stripes = ((len - 1) - blockLen * blocks) / stripeLen;
+
+    for (size_t s = 0; s < stripes; ++s)
+    {
+        accumulate512(acc, input + blocks * blockLen + s * stripeLen, secret + s * secretConsumeRate);
+    }
+
+    return finishLong(acc, input + len - stripeLen, len);
+}
+
+/**
+ * @brief      Hashes the whole input held in memory.
+ */
+Hash128 hashAll(const uint8_t *input, size_t len)
+{
+    Hash128 hash;
+
+    if (len == 0)
+    {
+        hash = {xxh64Avalanche(readLe64(secret + 64) ^ readLe64(secret + 72)),
+                xxh64Avalanche(readLe64(secret + 80) ^ readLe64(secret + 88))};
+    }
+    else if (len <= 3)
+    {
+        hash = len1to3(input, len);
+    }
+    else if (len <= 8)
+    {
+        hash = len4to8(input, len);
+    }
+    else if (len <= 16)
+    {
+        hash = len9to16(input, len);
+    }
+    else if (len <= 128)
+    {
+        hash = len17to128(input, len);
+    }
+    else if (len <= 240)
+    {
+        hash = len129to240(input, len);
+    }
+    else
+    {
+        hash = hashLong(input, len);
+    }
+
+    return hash;
+}
+
+/**
+ * @brief      Stores hash in canonical big-endian form.
+ */
+void storeCanonical(Hash128 hash, uint8_t out[16])
+{
+    for (int i = 0; i < 8; ++i)
+    {
+        out[i] = static_cast<uint8_t>(hash.high >> (56 - 8 * i));
+        out[8 + i] = static_cast<uint8_t>(hash.low >> (56 - 8 * i));
+    }
+}
+
+} // namespace
+
+void xxh128(const void *data, size_t len, uint8_t out[16])
+{
+    storeCanonical(hashAll(static_cast<const uint8_t *>(data), len), out);
+}
+
+Xxh128Stream::Xxh128Stream()
+{
+    memcpy(_acc, initAcc, sizeof(_acc));
+}
+
+void Xxh128Stream::consume(uint64_t acc[8], size_t &stripes, const uint8_t *data, size_t count) const
+{
+    for (size_t s = 0; s < count; ++s)
+    {
+        accumulate512(acc, data + s * stripeLen, secret + stripes * secretConsumeRate);
+
+        if (++stripes == stripesPerBlock)
+        {
+            scramble(acc, secret + secretSize - stripeLen);
+            stripes = 0;
+        }
+    }
+}
+
+void Xxh128Stream::update(const void *data, size_t len)
+{
+    auto input = static_cast<const uint8_t *>(data);
+    _length += len;
+
+    if (_buffered + len <= sizeof(_buffer))
+    {
+        memcpy(_buffer + _buffered, input, len);
+        _buffered += len;
+        return;
+    }
+
+    if (_buffered > 0) // full buffer is followed by more data
+    {
+        size_t take = sizeof(_buffer) - _buffered;
+        memcpy(_buffer + _buffered, input, take);
+        input += take;
+        len -= take;
+        consume(_acc, _stripes, _buffer, sizeof(_buffer) / stripeLen);
+        memcpy(_lastStripe, _buffer + sizeof(_buffer) - stripeLen, stripeLen);
+        _buffered = 0;
+    }
+
+    // at least one byte stays for the end of input
+    size_t count = len > 0 ? (len - 1) / stripeLen : 0;
+
+    if (count > 0)
+    {
+        consume(_acc, _stripes, input, count);
+        memcpy(_lastStripe, input + (count - 1) * stripeLen, stripeLen);
+        input += count * stripeLen;
+        len -= count * stripeLen;
+    }
+
+    memcpy(_buffer, input, len);
+    _buffered = len;
+}
+
+void Xxh128Stream::finish(uint8_t out[16])
+{
+    if (_length <= 240) // short inputs are never accumulated, they are all in the buffer
+    {
+        storeCanonical(hashAll(_buffer, _buffered), out);
+        return;
+    }
+
+    uint64_t acc[8];
+    size_t stripes = _stripes;
+    uint8_t last[stripeLen];
+    memcpy(acc, _acc, sizeof(acc));
+
+    if (_buffered >= stripeLen)
+    {
+        consume(acc, stripes, _buffer, (_buffered - 1) / stripeLen);
+        memcpy(last, _buffer + _buffered - stripeLen, stripeLen);
+    }
+    else // the last stripe starts in the accumulated data
+    {
+        memcpy(last, _lastStripe + _buffered, stripeLen - _buffered);
+        memcpy(last + stripeLen - _buffered, _buffer, _buffered);
+    }
+
+    storeCanonical(finishLong(acc, last, _length), out);
+}
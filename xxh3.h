@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief      Calculates XXH3 128-bit hash with zero seed and default secret.
+ *
+ * @param[in]  data  The data.
+ * @param[in]  len   The data length in bytes.
+ * @param      out   The hash in canonical big-endian form, high half first, 16 bytes.
+ */
+void xxh128(const void *data, size_t len, uint8_t out[16]);
+
+/**
+ * @brief      XXH3 128-bit hash of data fed by parts, the same as xxh128() of their concatenation.
+ *
+ * Stripes are accumulated only when more data follows them, since the last
+ * stripe of input is processed differently. The last 256 bytes are buffered.
+ */
+class Xxh128Stream
+{
+public:
+    Xxh128Stream();
+
+    /**
+     * @brief      Hashes the next part of data.
+     *
+     * @param[in]  data  The data.
+     * @param[in]  len   The data length in bytes.
+     */
+    void update(const void *data, size_t len);
+
+    /**
+     * @brief      Gets the hash.
+     *
+     * @param      out   The hash in canonical big-endian form, high half first, 16 bytes.
+     */
+    void finish(uint8_t out[16]);
+private:
+    uint64_t _acc[8];
+    size_t _stripes = 0;      // stripes accumulated in the current block of stripes
+    uint8_t _buffer[256];     // data not accumulated yet
+    size_t _buffered = 0;
+    uint8_t _lastStripe[64];  // the last accumulated stripe, end of input may need it
+    uint64_t _length = 0;     // bytes hashed so far
+
+    void consume(uint64_t acc[8], size_t &stripes, const uint8_t *data, size_t count) const;
+};